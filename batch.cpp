@@ -0,0 +1,303 @@
+#include "batch.h"
+#include "bulk_import.h"
+#include "colors.h"
+#include "todo_file.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+// Splits the next blank-separated word off the front of `rest`
+static std::string next_word(std::string& rest) {
+    const size_t start = rest.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        rest.clear();
+        return std::string();
+    }
+    const size_t end = rest.find_first_of(" \t", start);
+    std::string word = rest.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    rest = end == std::string::npos ? std::string() : rest.substr(end);
+    return word;
+}
+
+// What is left of the line, less the blank that separated it
+static std::string remainder(const std::string& rest) {
+    const size_t start = rest.find_first_not_of(" \t");
+    return start == std::string::npos ? std::string() : rest.substr(start);
+}
+
+static bool parse_number(const std::string& word, int& value) {
+    if (word.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    const long parsed = std::strtol(word.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// A line break or other control character would split the journal record
+// and the list file line the description ends up in
+static bool printable(const std::string& desc) {
+    for (const char c : desc) {
+        if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f) return false;
+    }
+    return true;
+}
+
+// Checks a description for add; 0 if it can be used
+static int check_description(const std::string& desc, std::string& error) {
+    if (desc.empty()) {
+        error = "description cannot be empty";
+        return 2;
+    }
+    if (!printable(desc)) {
+        error = "description cannot hold line breaks or other control characters";
+        return 2;
+    }
+    return 0;
+}
+
+int batch::apply(TodoSession& session, const std::string& line, std::string& error) {
+    const TodoStore& store = session.lists();
+    std::string rest = line;
+    const std::string command = next_word(rest);
+    const std::string target = next_word(rest);
+
+    if (command == "add") {
+        const std::string desc = remainder(rest);
+        if (target == "-r") {
+            if (const int status = check_description(desc, error)) return status;
+            session.add_regular(desc);
+            return 0;
+        }
+
+        int priority;
+        if (!parse_number(target, priority)) {
+            error = "expected a priority or -r, got '" + target + "'";
+            return 2;
+        }
+        if (const int status = check_description(desc, error)) return status;
+        if (store.has_priority(priority)) session.bump_from(priority);
+        session.add_priority(priority, desc);
+        return 0;
+    }
+
+    if (command == "rm") {
+        if (target == "-r") {
+            int number;
+            if (!parse_number(next_word(rest), number) || !remainder(rest).empty()) {
+                error = "expected rm -r <number>";
+                return 2;
+            }
+            if (number < 1 || static_cast<size_t>(number) > store.regular_items().size()) {
+                error = "no regular item with that number";
+                return 1;
+            }
+            session.remove_regular(static_cast<size_t>(number - 1));
+            return 0;
+        }
+
+        int priority;
+        if (!parse_number(target, priority)) {
+            error = "expected a priority or -r, got '" + target + "'";
+            return 2;
+        }
+        if (!remainder(rest).empty()) {
+            error = "expected rm <priority>";
+            return 2;
+        }
+        const TodoStore::ItemId id = store.find_priority(priority);
+        if (id == TodoStore::NO_ITEM) {
+            error = "no item with priority " + target;
+            return 1;
+        }
+        session.remove_priority(id, priority);
+        return 0;
+    }
+
+    if (command == "renumber") {
+        if (!target.empty()) {
+            error = "renumber takes no arguments";
+            return 2;
+        }
+        session.compact_priorities();
+        return 0;
+    }
+
+    if (command == "move" || command == "interleave") {
+        const size_t count = command == "move" ? 3 : 4;
+        int numbers[4];
+        std::string word = target;
+        for (size_t i = 0; i < count; i++) {
+            if (!parse_number(word, numbers[i])) {
+                error = command == "move" ? "expected <first> <last> <before>"
+                                          : "expected <first> <last> <second first> <second last>";
+                return 2;
+            }
+            word = next_word(rest);
+        }
+        if (!word.empty()) {
+            error = command + " takes " + std::to_string(count) + " numbers";
+            return 2;
+        }
+        if (numbers[0] > numbers[1] || (count == 4 && (numbers[1] >= numbers[2] || numbers[2] > numbers[3]))) {
+            error = count == 3 ? "the range is backwards" : "the ranges must be in order and not overlap";
+            return 2;
+        }
+        // A move or interleave that changes nothing is not an error
+        if (count == 3) session.move_priorities(numbers[0], numbers[1], numbers[2]);
+        else session.interleave_priorities(numbers[0], numbers[1], numbers[2], numbers[3]);
+        return 0;
+    }
+
+    error = "unknown command '" + command + "'";
+    return 2;
+}
+
+// Applies every command in `input`; stops at the first bad one
+static bool apply_all(TodoSession& session, std::istream& input, size_t& applied) {
+    std::string line;
+    size_t number = 0;
+    applied = 0;
+    while (std::getline(input, line)) {
+        number++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        const size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') continue;
+
+        std::string error;
+        if (batch::apply(session, line, error) != 0) {
+            std::cout << RED << "  [ERROR] line " << number << ": " << error << RESET << "\n";
+            return false;
+        }
+        applied++;
+    }
+    return true;
+}
+
+// Commits, telling the user if the lists had to be merged first
+static bool commit(TodoSession& session) {
+    if (!session.has_changes()) return true;
+    if (!session.commit()) {
+        std::cout << RED << "  [ERROR] Could not write the journal next to: " << session.priority_path() << RESET << "\n";
+        return false;
+    }
+    if (session.merged()) {
+        std::cout << CYAN << "  [i] Merged with changes committed elsewhere";
+        if (session.dropped()) std::cout << " (" << session.dropped() << " edits skipped, their items are gone)";
+        std::cout << RESET << "\n";
+    }
+    return true;
+}
+
+void batch::usage() {
+    std::cout << "       todo-bbs [--global] add <priority> <description> | add -r <description>\n"
+              << "       todo-bbs [--global] rm <priority> | rm -r <number>\n"
+              << "       todo-bbs [--global] ls [priority|regular]\n"
+              << "       todo-bbs [--global] import [--file <path>]\n"
+              << "       todo-bbs [--global] merge [--priority <path>] [--regular <path>]\n"
+              << "       todo-bbs [--global] renumber | move <first> <last> <before>\n"
+              << "       todo-bbs [--global] interleave <first> <last> <second first> <second last>\n"
+              << "       (--list <name> before the command, with or without --global, works on a named list)\n";
+}
+
+int batch::run(TodoSession& session, const std::vector<std::string>& args) {
+    const std::string command = args.empty() ? std::string() : args[0];
+    if (command != "add" && command != "rm" && command != "ls" && command != "import" && command != "merge"
+        && command != "renumber" && command != "move" && command != "interleave") {
+        usage();
+        return 2;
+    }
+
+    // Every argument is checked before the lists are loaded
+    std::string priority_dump, regular_dump;
+    if (command == "merge") {
+        bool malformed = false;
+        for (size_t i = 1; i < args.size(); i += 2) {
+            if (i + 1 >= args.size() || args[i + 1].empty()) malformed = true;
+            else if (args[i] == "--priority") priority_dump = args[i + 1];
+            else if (args[i] == "--regular") regular_dump = args[i + 1];
+            else malformed = true;
+        }
+        if (malformed || (priority_dump.empty() && regular_dump.empty())) {
+            usage();
+            return 2;
+        }
+    }
+    if (command == "ls" && (args.size() > 2 || (args.size() == 2 && args[1] != "priority" && args[1] != "regular"))) {
+        usage();
+        return 2;
+    }
+    const bool from_file = command == "import" && args.size() == 3 && args[1] == "--file" && args[2] != "-";
+    if (command == "import" && args.size() != 1 && !(args.size() == 3 && args[1] == "--file" && !args[2].empty())) {
+        usage();
+        return 2;
+    }
+
+    if (!session.load()) {
+        std::cout << RED << "  [ERROR] Could not read " << session.priority_path()
+                  << ": " << session.error() << RESET << "\n";
+        return 1;
+    }
+
+    if (command == "ls") {
+        const std::string which = args.size() > 1 ? args[1] : std::string();
+        std::string out;
+        if (which != "regular") todofile::format(session.lists(), true, out);
+        if (which != "priority") todofile::format(session.lists(), false, out);
+        std::cout << out;
+        return 0;
+    }
+
+    size_t applied = 1;
+    if (command == "merge") {
+        bulkimport::Report report;
+        std::string error;
+        if (!bulkimport::merge(session, priority_dump, regular_dump, report, error)) {
+            std::cout << RED << "  [ERROR] " << error << RESET << "\n";
+            return 1;
+        }
+        if (!commit(session)) return 1;
+        const double rate = report.seconds > 0 ? static_cast<double>(report.read) / report.seconds : 0;
+        std::cout << GREEN << "  [✓] Added " << report.added << " of " << report.read << " items ("
+                  << report.duplicates << " duplicates skipped)" << RESET << "\n";
+        std::cout << CYAN << "  [i] " << std::fixed << std::setprecision(3) << report.seconds << " s, " << static_cast<unsigned long>(rate)
+                  << " items/sec" << RESET << "\n";
+        return 0;
+    }
+
+    if (command == "import") {
+        bool ok;
+        if (from_file) {
+            std::ifstream file(args[2]);
+            if (!file.is_open()) {
+                std::cout << RED << "  [ERROR] Could not open " << args[2] << RESET << "\n";
+                return 1;
+            }
+            ok = apply_all(session, file, applied);
+        } else {
+            ok = apply_all(session, std::cin, applied);
+        }
+        if (!ok) {
+            std::cout << RED << "  [✗] Nothing was committed" << RESET << "\n";
+            return 1;
+        }
+    } else {
+        std::string line = command;
+        for (size_t i = 1; i < args.size(); i++) line += " " + args[i];
+
+        std::string error;
+        if (const int status = apply(session, line, error)) {
+            std::cout << RED << "  [ERROR] " << error << RESET << "\n";
+            if (status == 2) usage();
+            return status;
+        }
+    }
+
+    if (!commit(session)) return 1;
+    if (command == "import") std::cout << GREEN << "  [✓] Applied " << applied << " operations" << RESET << "\n";
+    return 0;
+}
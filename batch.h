@@ -0,0 +1,49 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include "todo_session.h"
+
+// Headless commands, for scripts that would otherwise drive the menus:
+//
+//   add <priority> <description>   add a priority item, bumping any
+//                                  conflicting items down
+//   add -r <description>           add a regular item
+//   rm <priority>                  remove the (first) item with a priority
+//   rm -r <number>                 remove regular item <number>, from 1
+//   renumber                       give the priority items 1..N, in order
+//   move <first> <last> <before>   move the items with priorities in
+//                                  [first, last] to just before <before>
+//   interleave <first> <last> <second first> <second last>
+//                                  deal the items of two ranges out in
+//                                  turn, into the place of the first
+//   ls [priority|regular]          print the lists in their file format
+//   import [--file <path>]         apply one add, rm, renumber, move or
+//                                  interleave per line of the file (stdin
+//                                  without --file); blank lines and lines
+//                                  starting with '#' are skipped
+//   merge [--priority <path>] [--regular <path>]
+//                                  add every item of exported list files
+//                                  not already present (see bulkimport)
+//
+// Each invocation is a single load, edit, commit cycle, so an import of
+// thousands of lines is one journal append. A batch with any bad line is
+// rejected whole and nothing is committed. Unknown, missing or malformed
+// arguments (a description with a line break among them) print the usage
+// and exit with 2.
+class batch {
+public:
+    // Runs `args` (the command line after the program name and location
+    // options) against `session`; returns the process exit code
+    static int run(TodoSession& session, const std::vector<std::string>& args);
+
+    // Applies one command line (any but ls, import and merge); returns 0,
+    // or with `error` set, 2 if the line is malformed and 1 if it does not
+    // fit the lists
+    static int apply(TodoSession& session, const std::string& line, std::string& error);
+
+    static void usage();
+};
+
+#endif
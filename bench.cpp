@@ -0,0 +1,941 @@
+// Microbenchmarks for TODO-BBS hot paths.
+// Usage: todo-bbs-bench [insert count] [loader lines] [box lines]
+//        todo-bbs-bench --suite [--sizes N,N,...] [--json FILE]
+//
+// --suite times loading, saving, drawing, lookup and bumping at 1k, 100k
+// and 1M items instead, and --json writes those timings to FILE for
+// tracking across builds.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <fstream>
+#include <set>
+#include <thread>
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "bench_util.h"
+#include "priority_index.h"
+#include "todo_file.h"
+#include "boxes.h"
+#include "list_view.h"
+#include "search_index.h"
+#include "todo_session.h"
+#include "bulk_import.h"
+#include "colors.h"
+
+namespace {
+
+// The pre-index algorithm: linear lookup, bump by rewriting every item
+struct LinearItem {
+    std::string description;
+    int priority;
+};
+
+void linear_insert(std::vector<LinearItem>& list, const int priority, const std::string& desc) {
+    bool conflict = false;
+    for (const auto& item : list) {
+        if (item.priority == priority) {
+            conflict = true;
+            break;
+        }
+    }
+    if (conflict) {
+        for (auto& item : list) {
+            if (item.priority >= priority) item.priority++;
+        }
+    }
+    list.push_back({desc, priority});
+}
+
+void index_insert(PriorityIndex<std::string>& list, const int priority, const std::string& desc) {
+    if (list.contains(priority)) list.bump_from(priority);
+    list.insert(priority, desc);
+}
+
+void bench_priority_insert(const size_t count) {
+    // Draw from half the key space so most inserts hit an existing priority
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(1, static_cast<int>(count / 2) + 1);
+    std::vector<int> priorities(count);
+    for (auto& p : priorities) p = dist(rng);
+
+    std::cout << "priority insert with bump-on-conflict, " << count << " items\n";
+
+    Timer index_timer;
+    PriorityIndex<std::string> index;
+    for (size_t i = 0; i < count; i++) index_insert(index, priorities[i], "task");
+    report("PriorityIndex", count, index_timer.ms());
+
+    // The quadratic baseline is capped so the run stays short; the index is
+    // replayed on the same prefix to check both agree on the result
+    const size_t linear_count = std::min<size_t>(count, 20000);
+    Timer linear_timer;
+    std::vector<LinearItem> linear;
+    for (size_t i = 0; i < linear_count; i++) linear_insert(linear, priorities[i], "task");
+    report("linear scan (" + std::to_string(linear_count) + ")", linear_count, linear_timer.ms());
+
+    PriorityIndex<std::string> check;
+    for (size_t i = 0; i < linear_count; i++) index_insert(check, priorities[i], "task");
+
+    std::vector<int> expected;
+    for (const auto& item : linear) expected.push_back(item.priority);
+    std::sort(expected.begin(), expected.end());
+    std::vector<int> actual;
+    for (const auto& entry : check) actual.push_back(entry.first);
+    if (expected != actual) {
+        std::cout << "  [ERROR] PriorityIndex disagrees with the linear algorithm\n";
+        std::exit(1);
+    }
+
+    // Rank access must agree with walking the list
+    size_t position = 0;
+    for (const auto& entry : check) {
+        const size_t below = static_cast<size_t>(std::lower_bound(expected.begin(), expected.end(), entry.first) - expected.begin());
+        if ((*check.at(position)).first != entry.first || check.rank(entry.first) != below) {
+            std::cout << "  [ERROR] PriorityIndex rank access disagrees at position " << position << "\n";
+            std::exit(1);
+        }
+        position++;
+    }
+}
+
+void bench_loader(const size_t lines) {
+    const std::string path = "/tmp/todo-bbs-bench-priority.txt";
+    write_priority_file(path, lines);
+
+    std::cout << "priority file load, " << lines << " lines\n";
+
+    Timer legacy_timer;
+    std::vector<LegacyItem> legacy;
+    legacy_load(path, legacy);
+    report("getline + stoi", lines, legacy_timer.ms());
+
+    Timer mapped_timer;
+    TodoStore mapped;
+    todofile::load(path, mapped, true);
+    report("mmap + scan   ", lines, mapped_timer.ms());
+
+    std::remove(path.c_str());
+
+    // The generated file is already in priority order, so both agree line by line
+    if (legacy.size() != mapped.priority_items().size()) {
+        std::cout << "  [ERROR] Loaders disagree on the item count\n";
+        std::exit(1);
+    }
+    size_t line = 0;
+    for (const auto& entry : mapped.priority_items()) {
+        if (legacy[line].priority != entry.first || legacy[line].description != mapped.description(entry.second)) {
+            std::cout << "  [ERROR] Loaders disagree on line " << (line + 1) << "\n";
+            std::exit(1);
+        }
+        line++;
+    }
+}
+
+void bench_viewport(const size_t lines) {
+    TodoStore store;
+    std::vector<std::pair<int, TodoStore::ItemId>> entries;
+    entries.reserve(lines);
+    for (size_t i = 0; i < lines; i++) {
+        const std::string desc = "task number " + std::to_string(i * 7919 % 100003);
+        entries.emplace_back(static_cast<int>(i + 1), store.add_text(desc.data(), desc.size(), TodoStore::LIVE | TodoStore::PRIORITY));
+    }
+    store.assign_priorities(entries);
+
+    std::cout << "list drawing, " << lines << " items\n";
+
+    Timer full_timer;
+    std::vector<std::string> contents;
+    for (const auto& entry : store.priority_items()) {
+        contents.push_back("[" + std::to_string(entry.first) + "] " + store.description(entry.second));
+    }
+    std::string full;
+    boxes::render(full, "PRIORITY TODO LIST", contents, CYAN, MAGENTA BOLD, "  ");
+    report("whole list      ", 1, full_timer.ms());
+
+    // A 40-row window paged across the list, one revision throughout
+    const size_t frames = 1000;
+    ListView view(store, true, "PRIORITY TODO LIST", CYAN, MAGENTA BOLD);
+    view.resize(40);
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> target(1, static_cast<int>(lines));
+    size_t bytes = 0;
+    Timer window_timer;
+    for (size_t i = 0; i < frames; i++) {
+        view.jump(target(rng));
+        bytes += view.render(1).size();
+    }
+    report("40-row window   ", frames, window_timer.ms());
+    if (bytes == 0) std::exit(1);
+}
+
+// Every live item whose description contains `needle`, found the slow way
+std::vector<TodoStore::ItemId> brute_force_search(const TodoStore& store, const std::string& needle) {
+    std::vector<TodoStore::ItemId> found;
+    auto check = [&](const TodoStore::ItemId id) {
+        std::string desc = store.description(id);
+        for (char& c : desc) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (desc.find(needle) != std::string::npos) found.push_back(id);
+    };
+    for (const auto& entry : store.priority_items()) check(entry.second);
+    for (const TodoStore::ItemId id : store.regular_items()) check(id);
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+void bench_search(const size_t items) {
+    static const char* const words[] = {
+        "fix", "review", "deploy", "Backup", "server", "invoice", "call", "team", "release",
+        "notes", "update", "docs", "migrate", "database", "renew", "TLS", "cert", "plan", "sprint", "budget"
+    };
+    const size_t word_count = sizeof(words) / sizeof(words[0]);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<size_t> word(0, word_count - 1);
+    auto description = [&](const size_t i) {
+        return std::string(words[word(rng)]) + " " + words[word(rng)] + " " + words[word(rng)] + " #" + std::to_string(i);
+    };
+
+    TodoStore store;
+    for (size_t i = 0; i < items; i++) {
+        if (i % 2) store.add_regular(description(i));
+        else store.add_priority(static_cast<int>(i), description(i));
+    }
+
+    std::cout << "search, " << items << " items\n";
+
+    Timer build_timer;
+    SearchIndex index(store);
+    index.build();
+    report("trigram build   ", items, build_timer.ms());
+
+    // Substrings of real descriptions, some anchored
+    std::vector<std::string> queries;
+    std::uniform_int_distribution<size_t> pick(0, items - 1);
+    for (size_t i = 0; i < 1000; i++) {
+        const std::string desc = description(pick(rng));
+        const size_t length = 3 + i % 8;
+        const size_t start = i % 3 == 0 ? 0 : i % (desc.size() - length + 1);
+        queries.push_back((i % 3 == 0 ? "^" : "") + desc.substr(start, length));
+    }
+
+    std::vector<TodoStore::ItemId> results;
+    Timer query_timer;
+    for (const std::string& query : queries) {
+        results.clear();
+        index.find(query, results, 50);
+    }
+    report("query, 50 shown ", queries.size(), query_timer.ms());
+
+    // Remove and add a batch through the index, then every result set must
+    // match a full scan. Freed ids are reused, so the adds land mid-list.
+    const size_t edits = 1000;
+    double remove_ms = 0, add_ms = 0;
+    for (size_t i = 0; i < edits; i++) {
+        const TodoStore::ItemId id = store.regular_items()[0];
+        Timer remove_timer;
+        index.remove(id);
+        remove_ms += remove_timer.ms();
+        store.remove_regular(0);
+        const TodoStore::ItemId added = store.add_regular(description(items + i));
+        Timer add_timer;
+        index.add(added);
+        add_ms += add_timer.ms();
+    }
+    report("remove          ", edits, remove_ms);
+    report("add             ", edits, add_ms);
+    if (remove_ms / static_cast<double>(edits) >= 1.0 || add_ms / static_cast<double>(edits) >= 1.0) {
+        std::cout << "  [ERROR] Index updates are not sub-millisecond\n";
+        std::exit(1);
+    }
+    for (size_t i = 0; i < 200; i++) {
+        std::string needle = queries[i].substr(queries[i][0] == '^' ? 1 : 0);
+        for (char& c : needle) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        results.clear();
+        index.find(needle, results, items);
+        std::sort(results.begin(), results.end());
+        if (results != brute_force_search(store, needle)) {
+            std::cout << "  [ERROR] search for \"" << needle << "\" disagrees with a full scan\n";
+            std::exit(1);
+        }
+    }
+
+    // Item priorities read back through their handles must match the
+    // index order after a run of bumps
+    std::uniform_int_distribution<int> bump(0, static_cast<int>(items));
+    for (size_t i = 0; i < 100; i++) store.bump_from(bump(rng));
+    for (const auto& entry : store.priority_items()) {
+        if (store.priority_of(entry.second) != entry.first) {
+            std::cout << "  [ERROR] priority_of disagrees with the index order\n";
+            std::exit(1);
+        }
+    }
+}
+
+// Both lists flattened, to compare two stores item for item
+std::vector<std::pair<int, std::string>> snapshot(const TodoStore& store) {
+    std::vector<std::pair<int, std::string>> items;
+    for (const auto& entry : store.priority_items()) items.emplace_back(entry.first, store.description(entry.second));
+    for (const TodoStore::ItemId id : store.regular_items()) items.emplace_back(0, store.description(id));
+    return items;
+}
+
+void remove_lists(const std::string& dir) {
+    for (const char* name : {"priority_todo.txt", "regular_todo.txt", "todo_journal.txt", "todo_commit.lock",
+                             "todo_compact.lock", "todo_commit.pending"}) {
+        std::remove((dir + name).c_str());
+    }
+}
+
+bool has_item(const TodoStore& store, const std::string& desc, const int priority) {
+    for (const auto& entry : store.priority_items()) {
+        if (store.description(entry.second) == desc) return priority == 0 || entry.first == priority;
+    }
+    return false;
+}
+
+void bench_import(const size_t lines) {
+    const std::string priority_path = "/tmp/priority_todo.txt";
+    const std::string regular_path = "/tmp/regular_todo.txt";
+    const std::string dump_path = "/tmp/todo-bbs-bench-dump.txt";
+    const size_t existing = lines / 2;
+
+    remove_lists("/tmp/");
+    write_priority_file(priority_path, existing);
+    std::ofstream(regular_path).close();
+
+    // Every 8th line repeats an item already in the list and a quarter of
+    // the rest repeat each other; priorities land all over the existing range
+    TodoSession merged(priority_path, regular_path);
+    merged.load();
+    {
+        std::vector<std::string> present;
+        for (const auto& entry : merged.lists().priority_items()) present.push_back(merged.lists().description(entry.second));
+
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<int> priority(1, static_cast<int>(existing) + 1);
+        std::ofstream dump(dump_path);
+        for (size_t i = 0; i < lines; i++) {
+            dump << priority(rng) << "|";
+            if (i % 8 == 0) dump << present[i / 8 % present.size()] << "\n";
+            else dump << "imported task " << (i % (lines * 3 / 4)) << "\n";
+        }
+    }
+
+    std::cout << "bulk import, " << lines << " lines into " << existing << " items\n";
+
+    bulkimport::Report result;
+    std::string error;
+    Timer bulk_timer;
+    bulkimport::merge(merged, dump_path, std::string(), result, error);
+    report("chunked + hashed", lines, bulk_timer.ms());
+    std::cout << "  " << static_cast<unsigned long>(result.read / result.seconds) << " items/sec, "
+              << result.added << " added, " << result.duplicates << " duplicates\n";
+
+    // One line, one lookup, one bump at a time, in the same (ascending) order
+    TodoSession single(priority_path, regular_path);
+    single.load();
+    Timer single_timer;
+    {
+        std::set<std::string> seen;
+        for (const auto& entry : single.lists().priority_items()) seen.insert(single.lists().description(entry.second));
+
+        std::vector<std::pair<int, std::string>> items;
+        std::ifstream dump(dump_path);
+        std::string line;
+        while (std::getline(dump, line)) {
+            const size_t bar = line.find('|');
+            std::string desc = line.substr(bar + 1);
+            if (seen.insert(desc).second) items.emplace_back(std::stoi(line.substr(0, bar)), desc);
+        }
+        std::stable_sort(items.begin(), items.end(),
+                         [](const std::pair<int, std::string>& a, const std::pair<int, std::string>& b) { return a.first < b.first; });
+        for (const auto& item : items) {
+            if (single.lists().has_priority(item.first)) single.bump_from(item.first);
+            single.add_priority(item.first, item.second);
+        }
+    }
+    report("one at a time   ", lines, single_timer.ms());
+
+    if (snapshot(merged.lists()) != snapshot(single.lists())) {
+        std::cout << "  [ERROR] Bulk import disagrees with adding the items one at a time\n";
+        std::exit(1);
+    }
+
+    // The recorded ops must rebuild the same lists from the files
+    merged.commit();
+    TodoSession replayed(priority_path, regular_path);
+    replayed.load();
+    if (snapshot(replayed.lists()) != snapshot(merged.lists())) {
+        std::cout << "  [ERROR] Replaying the import journal gives different lists\n";
+        std::exit(1);
+    }
+
+    remove_lists("/tmp/");
+    std::remove(dump_path.c_str());
+}
+
+void bench_commit(const size_t writers, const size_t commits) {
+    const std::string priority_path = "/tmp/priority_todo.txt";
+    const std::string regular_path = "/tmp/regular_todo.txt";
+    remove_lists("/tmp/");
+    write_priority_file(priority_path, 5);
+    std::ofstream(regular_path).close();
+
+    std::cout << "commit, " << writers << " processes x " << commits << " commits\n";
+
+    // Two sessions edit the same lists; the later commit is merged onto
+    // the earlier one's
+    {
+        TodoSession first(priority_path, regular_path), second(priority_path, regular_path);
+        first.load();
+        second.load();
+        const std::string third = first.lists().description(first.lists().find_priority(3));
+        const std::string fifth = first.lists().description(first.lists().find_priority(5));
+
+        second.bump_from(1);
+        second.add_priority(1, "added first");
+        second.remove_priority(second.lists().find_priority(4), 4);
+        second.commit();
+
+        first.remove_priority(first.lists().find_priority(3), 3);
+        first.add_priority(2, "added second");
+        first.reassign(first.lists().find_priority(5), 5, 1);
+        first.commit();
+
+        TodoSession check(priority_path, regular_path);
+        check.load();
+        if (!first.merged() || first.dropped() != 1 || snapshot(check.lists()) != snapshot(first.lists())
+            || !has_item(check.lists(), "added first", 0) || !has_item(check.lists(), "added second", 0)
+            || has_item(check.lists(), third, 0) || !has_item(check.lists(), fifth, 1)
+            || check.lists().priority_items().size() != 6) {
+            std::cout << "  [ERROR] Merging two sessions' commits lost or misplaced an edit\n";
+            std::exit(1);
+        }
+    }
+
+    // A watching session picks up another's commits, appended or folded,
+    // without being told
+    {
+        TodoSession watching(priority_path, regular_path), other(priority_path, regular_path);
+        watching.load();
+        watching.watch();
+        other.load();
+        watching.add_regular("pending here");
+
+        double seen_ms = 0;
+        for (size_t round = 0; round < 20; round++) {
+            if (other.lists().has_priority(1)) other.bump_from(1);
+            other.add_priority(1, "from elsewhere " + std::to_string(round) + std::string(round == 10 ? 300000 : 0, 'x'));
+            other.commit();
+
+            Timer timer;
+            while (!watching.sync() && timer.ms() < 2000) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            seen_ms += timer.ms();
+
+            TodoSession check(priority_path, regular_path);
+            check.load();
+            check.add_regular("pending here");
+            if (snapshot(check.lists()) != snapshot(watching.lists())) {
+                std::cout << "  [ERROR] A watching session missed a commit made elsewhere\n";
+                std::exit(1);
+            }
+        }
+        report("seen by watcher ", 20, seen_ms);
+    }
+
+    // Nobody else writing: the lock is held for two stats and an append
+    {
+        TodoSession session(priority_path, regular_path);
+        session.load();
+        Timer timer;
+        for (size_t i = 0; i < commits; i++) {
+            session.add_regular("solo " + std::to_string(i));
+            session.commit();
+        }
+        report("uncontended     ", commits, timer.ms());
+    }
+
+#ifndef _WIN32
+    // Every writer adds at the top of the list, so nearly every commit
+    // finds another process's commit ahead of it and has to merge
+    Timer timer;
+    std::vector<pid_t> children;
+    for (size_t w = 0; w < writers; w++) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            bool committed = true;
+            {
+                TodoSession session(priority_path, regular_path);
+                session.load();
+                for (size_t i = 0; i < commits && committed; i++) {
+                    if (session.lists().has_priority(1)) session.bump_from(1);
+                    session.add_priority(1, "writer " + std::to_string(w) + " item " + std::to_string(i));
+                    committed = session.commit();
+                }
+            }  // joins any compaction still running
+            _exit(committed ? 0 : 1);
+        }
+        children.push_back(pid);
+    }
+    bool ok = true;
+    for (const pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    report("contended       ", writers * commits, timer.ms());
+
+    TodoSession check(priority_path, regular_path);
+    check.load();
+    std::set<int> priorities;
+    for (const auto& entry : check.lists().priority_items()) priorities.insert(entry.first);
+    for (size_t w = 0; w < writers && ok; w++) {
+        for (size_t i = 0; i < commits && ok; i++) {
+            ok = has_item(check.lists(), "writer " + std::to_string(w) + " item " + std::to_string(i), 0);
+        }
+    }
+    if (!ok || priorities.size() != check.lists().priority_items().size()) {
+        std::cout << "  [ERROR] Concurrent commits lost an edit or duplicated a priority\n";
+        std::exit(1);
+    }
+#endif
+
+    remove_lists("/tmp/");
+}
+
+// Autosave: the caller only swaps the pending ops out; the append and its
+// flush happen on the saver thread. Edits keep coming while it writes.
+void bench_autosave(const size_t edits) {
+    const std::string priority_path = "/tmp/priority_todo.txt";
+    const std::string regular_path = "/tmp/regular_todo.txt";
+    remove_lists("/tmp/");
+    write_priority_file(priority_path, 1000);
+    std::ofstream(regular_path).close();
+
+    std::cout << "autosave, " << edits << " edits, a save every 10\n";
+
+    TodoSession session(priority_path, regular_path);
+    session.load();
+    double save_ms = 0, worst_ms = 0;
+    size_t saves = 0;
+    for (size_t i = 0; i < edits; i++) {
+        if (session.lists().has_priority(1)) session.bump_from(1);
+        session.add_priority(1, "edit " + std::to_string(i));
+        if (i % 10 != 9) continue;
+
+        Timer timer;
+        if (!session.save()) {
+            std::cout << "  [ERROR] Autosave failed\n";
+            std::exit(1);
+        }
+        const double ms = timer.ms();
+        save_ms += ms;
+        worst_ms = std::max(worst_ms, ms);
+        saves++;
+    }
+    report("save(), caller  ", saves, save_ms);
+    std::cout << "  slowest save(): " << worst_ms << " ms\n";
+
+    Timer timer;
+    session.commit();
+    report("final commit    ", 1, timer.ms());
+
+    TodoSession check(priority_path, regular_path);
+    check.load();
+    if (session.has_changes() || snapshot(check.lists()) != snapshot(session.lists())) {
+        std::cout << "  [ERROR] Autosaved lists differ from the session's\n";
+        std::exit(1);
+    }
+    remove_lists("/tmp/");
+}
+
+// Undo and redo on a long list: every step bumps the whole list down, yet
+// stores one op for it and takes one O(log n) shift to undo
+void bench_undo(const size_t items, const size_t steps) {
+    const std::string priority_path = "/tmp/priority_todo.txt";
+    const std::string regular_path = "/tmp/regular_todo.txt";
+    remove_lists("/tmp/");
+    write_priority_file(priority_path, items);
+    std::ofstream(regular_path).close();
+
+    std::cout << "undo, " << steps << " steps on " << items << " items\n";
+
+    TodoSession session(priority_path, regular_path);
+    session.load();
+    session.keep_history(true);
+    const std::vector<std::pair<int, std::string>> before = snapshot(session.lists());
+
+    Timer timer;
+    for (size_t i = 0; i < steps; i++) {
+        session.bump_from(1);
+        session.add_priority(1, "step " + std::to_string(i));
+        if (i % 3 == 0) session.reassign(session.lists().find_priority(2), 2, static_cast<int>(items) * 2 + static_cast<int>(i));
+        if (i % 5 == 0) session.add_regular("regular " + std::to_string(i));
+        session.end_step();
+    }
+    report("edit            ", steps, timer.ms());
+    const std::vector<std::pair<int, std::string>> after = snapshot(session.lists());
+
+    timer = Timer();
+    size_t undone = 0;
+    while (session.undo()) undone++;
+    report("undo            ", undone, timer.ms());
+    if (undone != steps || snapshot(session.lists()) != before || !session.lists().regular_items().empty()) {
+        std::cout << "  [ERROR] Undoing every step did not restore the lists\n";
+        std::exit(1);
+    }
+
+    timer = Timer();
+    size_t redone = 0;
+    while (session.redo()) redone++;
+    report("redo            ", redone, timer.ms());
+    if (redone != steps || snapshot(session.lists()) != after) {
+        std::cout << "  [ERROR] Redoing every step did not restore the lists\n";
+        std::exit(1);
+    }
+
+    // The undos and redos are edits too; replayed from the journal they
+    // give the same lists
+    session.commit();
+    TodoSession check(priority_path, regular_path);
+    check.load();
+    if (snapshot(check.lists()) != after) {
+        std::cout << "  [ERROR] Undo and redo did not replay from the journal\n";
+        std::exit(1);
+    }
+    remove_lists("/tmp/");
+}
+
+// One timing from the scaling suite, as written by --json
+struct SuiteResult {
+    std::string benchmark;
+    size_t items;
+    size_t ops;
+    double ms;
+};
+
+std::vector<SuiteResult> suite_results;
+
+void suite_report(const std::string& benchmark, const size_t items, const size_t ops, const double ms) {
+    report(benchmark + std::string(benchmark.size() < 16 ? 16 - benchmark.size() : 0, ' '), ops, ms);
+    suite_results.push_back(SuiteResult{benchmark, items, ops, ms});
+}
+
+bool write_json(const std::string& path) {
+    std::ofstream out(path);
+    out << "{\"results\": [\n";
+    for (size_t i = 0; i < suite_results.size(); i++) {
+        const SuiteResult& r = suite_results[i];
+        out << "  {\"benchmark\": \"" << r.benchmark << "\", \"items\": " << r.items << ", \"ops\": " << r.ops
+            << ", \"ms\": " << r.ms << ", \"ns_per_op\": " << (r.ms * 1e6 / static_cast<double>(r.ops)) << "}"
+            << (i + 1 < suite_results.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    return static_cast<bool>(out.flush());
+}
+
+// The paths a session spends its time in, on generated lists of `items`
+// priority items (a tenth as many regular ones, a tenth of words UTF-8)
+void bench_scaling(const size_t items) {
+    const std::string priority_path = "/tmp/todo-bbs-suite-priority.txt";
+    const std::string regular_path = "/tmp/todo-bbs-suite-regular.txt";
+    DatasetSpec spec;
+    spec.priority_items = items;
+    spec.regular_items = items / 10;
+    spec.utf8_percent = 10;
+    write_dataset(spec, priority_path, regular_path);
+
+    std::cout << "suite, " << items << " items\n";
+
+    Timer timer;
+    TodoStore store;
+    todofile::load(priority_path, store, true);
+    todofile::load(regular_path, store, false);
+    suite_report("load", items, 1, timer.ms());
+    if (store.priority_items().size() != items) {
+        std::cout << "  [ERROR] Loaded " << store.priority_items().size() << " of " << items << " items\n";
+        std::exit(1);
+    }
+
+    // Both files rendered and written out with an fsync each, as a fold does
+    timer = Timer();
+    std::string contents;
+    todofile::format(store, true, contents);
+    bool saved = todofile::write_temp(priority_path, contents);
+    contents.clear();
+    todofile::format(store, false, contents);
+    saved = todofile::write_temp(regular_path, contents) && saved;
+    suite_report("save", items, 1, timer.ms());
+    std::remove((priority_path + ".tmp").c_str());
+    std::remove((regular_path + ".tmp").c_str());
+    std::remove(priority_path.c_str());
+    std::remove(regular_path.c_str());
+    if (!saved) {
+        std::cout << "  [ERROR] Could not write the lists\n";
+        std::exit(1);
+    }
+
+    timer = Timer();
+    std::vector<std::string> contents_lines;
+    contents_lines.reserve(items);
+    for (const auto& entry : store.priority_items()) {
+        contents_lines.push_back("[" + std::to_string(entry.first) + "] " + store.description(entry.second));
+    }
+    std::string full;
+    boxes::render(full, "PRIORITY TODO LIST", contents_lines, CYAN, MAGENTA BOLD, "  ");
+    suite_report("render_full", items, 1, timer.ms());
+
+    const size_t frames = 1000;
+    ListView view(store, true, "PRIORITY TODO LIST", CYAN, MAGENTA BOLD);
+    view.resize(40);
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> priority(1, static_cast<int>(items));
+    size_t bytes = 0;
+    timer = Timer();
+    for (size_t i = 0; i < frames; i++) {
+        view.jump(priority(rng));
+        bytes += view.render(1).size();
+    }
+    suite_report("render_window", items, frames, timer.ms());
+
+    const size_t lookups = 100000;
+    size_t found = 0;
+    timer = Timer();
+    for (size_t i = 0; i < lookups; i++) found += store.find_priority(priority(rng)) != TodoStore::NO_ITEM;
+    suite_report("find_priority", items, lookups, timer.ms());
+
+    const size_t bumps = 10000;
+    timer = Timer();
+    for (size_t i = 0; i < bumps; i++) store.bump_from(priority(rng));
+    suite_report("bump", items, bumps, timer.ms());
+
+    // The bulk renumberings, each one pass over the whole list; the bumps
+    // above left gaps for the first to close
+    const size_t passes = 10;
+    const int quarter = static_cast<int>(items / 4);
+    timer = Timer();
+    bool renumbered = store.compact_priorities();
+    suite_report("renumber", items, 1, timer.ms());
+
+    timer = Timer();
+    for (size_t i = 0; i < passes; i++) renumbered = store.move_priorities(1, quarter, 3 * quarter) && renumbered;
+    suite_report("move_range", items, passes, timer.ms());
+
+    timer = Timer();
+    for (size_t i = 0; i < passes; i++) {
+        renumbered = store.interleave_priorities(1, quarter, 2 * quarter + 1, 3 * quarter) && renumbered;
+    }
+    suite_report("interleave", items, passes, timer.ms());
+
+    if (bytes == 0 || found != lookups || !renumbered || store.priority_items().size() != items) {
+        std::cout << "  [ERROR] Suite results do not add up\n";
+        std::exit(1);
+    }
+}
+
+// The pre-render box path: helper temporaries per line, every line measured
+// twice, then indented one character at a time
+std::string legacy_indent(const std::string& text, const std::string& prefix) {
+    std::string result;
+    std::string line;
+    for (const char c : text) {
+        line += c;
+        if (c == '\n') {
+            result += prefix + line;
+            line.clear();
+        }
+    }
+    return result + line;  // the box always ends in a bare RESET
+}
+
+std::string legacy_box(std::string header, const std::vector<std::string>& contents,
+                       const std::string& bodyColor, const std::string& barColor) {
+    header = " " + header + " ";
+
+    u_long max_len = 0;
+    for (const auto& line : contents) {
+        const u_long line_len = visible_length(line);
+        if (line_len > max_len) max_len = line_len;
+    }
+
+    const u_long content_max = (visible_length(header) > max_len) ? visible_length(header) : max_len;
+    u_long actual_width = content_max + PADDING;
+    const u_long min_width_for_header = visible_length(header) + 6;
+    if (min_width_for_header > actual_width) actual_width = min_width_for_header;
+
+    std::string fin;
+    fin += barColor + boxes::namedHeader(header, actual_width) + RESET;
+    for (const auto& line : contents) {
+        fin += bodyColor + boxes::spacedContent(line, actual_width) + RESET;
+    }
+    fin += barColor + boxes::footer(actual_width) + RESET;
+    return fin;
+}
+
+void bench_box(const size_t lines) {
+    std::vector<std::string> contents;
+    contents.reserve(lines);
+    for (size_t i = 0; i < lines; i++) {
+        contents.push_back("[" + std::to_string(i + 1) + "] task number " + std::to_string(i * 7919 % 100003) + " • ✓");
+    }
+
+    std::cout << "box render, " << lines << " lines\n";
+
+    Timer legacy_timer;
+    const std::string legacy = legacy_indent(legacy_box("PRIORITY TODO LIST", contents, CYAN, MAGENTA BOLD), "  ");
+    report("box + indent", lines, legacy_timer.ms());
+
+    Timer render_timer;
+    std::string rendered;
+    boxes::render(rendered, "PRIORITY TODO LIST", contents, CYAN, MAGENTA BOLD, "  ");
+    report("render      ", lines, render_timer.ms());
+
+    if (legacy != rendered) {
+        std::cout << "  [ERROR] render output differs from box + indent\n";
+        std::exit(1);
+    }
+}
+
+// Checks the dispatched visible_length against the scalar reference on
+// random strings built from the pieces the vector path has to get right:
+// escapes, every UTF-8 length, wide and zero-width characters, joiners and
+// broken sequences, placed at arbitrary offsets around the block boundaries
+void check_visible_length(const size_t rounds) {
+    struct Known {
+        const char* text;
+        size_t width;
+    };
+    static const Known known[] = {
+        {"plain", 5}, {"\033[1m\033[36mbold\033[0m", 4}, {"caf\xc3\xa9", 4}, {"e\xcc\x81", 1},
+        {"\xe6\x97\xa5\xe6\x9c\xac", 4}, {"\xef\xbc\xa1", 2}, {"\xe2\x9c\x93 \xe2\x80\xa2", 3},
+        {"\xf0\x9f\x91\xa8\xe2\x80\x8d\xf0\x9f\x91\xa9\xe2\x80\x8d\xf0\x9f\x91\xa7", 2},
+        {"\xf0\x9f\x91\x8d\xf0\x9f\x8f\xbd", 2}, {"\xe2\x96\x91\xe2\x96\x92\xe2\x96\x93", 3}
+    };
+    for (const Known& k : known) {
+        if (visible_length(k.text) != k.width || visible_length_scalar(k.text) != k.width) {
+            std::cout << "  [ERROR] visible_length(\"" << k.text << "\") is " << visible_length(k.text)
+                      << ", expected " << k.width << "\n";
+            std::exit(1);
+        }
+    }
+
+    static const char* const pieces[] = {
+        "a", "Z", " ", "~", "\t", "\033[0m", "\033[1m\033[35m", "\033[", "m",
+        "\xc3\xa9", "\xc2\xa0", "\xcb\x86", "\xcc\x81", "\xd7\x90", "\xe2\x80\xa2", "\xe2\x95\x90",
+        "\xe2\x80\x8d", "\xef\xb8\x8f", "\xe4\xb8\xad", "\xea\xb0\x80", "\xf0\x9f\x98\x80",
+        "\xf0\x9f\x8f\xbb", "\xf0\xa0\x80\x80", "\x80", "\xbf", "\xc3", "\xe2\x80", "\xf0\x9f", "\xff"
+    };
+    const size_t piece_count = sizeof(pieces) / sizeof(pieces[0]);
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> pick(0, piece_count - 1);
+    std::uniform_int_distribution<int> runs(0, 120);
+    std::uniform_int_distribution<int> ascii(0, 3);
+
+    std::string text;
+    for (size_t round = 0; round < rounds; round++) {
+        text.clear();
+        const int count = runs(rng);
+        for (int i = 0; i < count; i++) {
+            // Mostly ASCII, like real descriptions, so the fast path runs too
+            if (ascii(rng)) text += static_cast<char>('a' + i % 26);
+            else text += pieces[pick(rng)];
+        }
+        if (visible_length(text) != visible_length_scalar(text)) {
+            std::cout << "  [ERROR] visible_length disagrees with the scalar reference on round " << round << "\n";
+            std::exit(1);
+        }
+    }
+    std::cout << "  visible_length matches the scalar reference on " << rounds << " random strings\n";
+}
+
+void bench_visible_length(const size_t lines) {
+    std::vector<std::string> contents;
+    contents.reserve(lines);
+    for (size_t i = 0; i < lines; i++) {
+        contents.push_back("\033[36m[" + std::to_string(i + 1) + "] follow up with the team about release " +
+                           std::to_string(i * 7919 % 100003) + " \xe2\x80\xa2 notes\033[0m");
+    }
+
+    std::cout << "visible_length, " << lines << " lines\n";
+    check_visible_length(200000);
+
+    size_t scalar_total = 0, vector_total = 0;
+    Timer scalar_timer;
+    for (const auto& line : contents) scalar_total += visible_length_scalar(line);
+    report("scalar    ", lines, scalar_timer.ms());
+
+    Timer vector_timer;
+    for (const auto& line : contents) vector_total += visible_length(line);
+    report("vectorized", lines, vector_timer.ms());
+
+    if (scalar_total != vector_total) {
+        std::cout << "  [ERROR] visible_length totals differ\n";
+        std::exit(1);
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> args;
+    std::vector<size_t> sizes = {1000, 100000, 1000000};
+    std::string json_path;
+    bool suite = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--suite") {
+            suite = true;
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+            suite = true;
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            sizes.clear();
+            const std::string list = argv[++i];
+            for (size_t start = 0; start < list.size();) {
+                const size_t comma = std::min(list.find(',', start), list.size());
+                const size_t items = std::strtoul(list.substr(start, comma - start).c_str(), nullptr, 10);
+                if (items > 0) sizes.push_back(items);
+                start = comma + 1;
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (suite) {
+        for (const size_t items : sizes) bench_scaling(items);
+        if (!json_path.empty() && !write_json(json_path)) {
+            std::cout << "  [ERROR] Could not write " << json_path << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    const size_t count = args.size() > 0 ? std::strtoul(args[0].c_str(), nullptr, 10) : 100000;
+    const size_t lines = args.size() > 1 ? std::strtoul(args[1].c_str(), nullptr, 10) : 1000000;
+    const size_t box_lines = args.size() > 2 ? std::strtoul(args[2].c_str(), nullptr, 10) : 100000;
+
+    bench_priority_insert(count);
+    bench_loader(lines);
+    bench_box(box_lines);
+    bench_visible_length(box_lines);
+    bench_viewport(lines);
+    bench_search(200000);
+    bench_import(lines);
+    bench_commit(4, 200);
+    bench_autosave(2000);
+    bench_undo(count, 1000);
+    return 0;
+}
@@ -0,0 +1,117 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+// Shared helpers for the benchmark targets
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Timer {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    double ms() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+inline void report(const std::string& name, const size_t ops, const double ms) {
+    std::cout << "  " << name << ": " << ms << " ms"
+              << " (" << (ms * 1e6 / static_cast<double>(ops)) << " ns/op)\n";
+}
+
+// How items were held before TodoStore: one heap string per item
+struct LegacyItem {
+    std::string description;
+    int priority;
+};
+
+// The original loader: getline, two substr temporaries and stoi per line
+inline void legacy_load(const std::string& filename, std::vector<LegacyItem>& list) {
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+        size_t pos = line.find('|');
+        if (pos != std::string::npos) {
+            int pri = std::stoi(line.substr(0, pos));
+            std::string desc = line.substr(pos + 1);
+            list.push_back({desc, pri});
+        }
+    }
+}
+
+// Writes `lines` priority items numbered 1..lines with 2-12 word descriptions
+inline void write_priority_file(const std::string& path, const size_t lines) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> words(2, 12);
+    std::ofstream out(path);
+    for (size_t i = 0; i < lines; i++) {
+        out << (i + 1) << "|";
+        const int count = words(rng);
+        for (int w = 0; w < count; w++) out << (w ? " " : "") << "word" << (rng() % 1000);
+        out << "\n";
+    }
+}
+
+// What todo-bbs-gen writes. Descriptions are runs of words, some drawn
+// from non-ASCII samples so width measuring meets real UTF-8.
+struct DatasetSpec {
+    size_t priority_items = 1000;
+    size_t regular_items = 0;
+    int min_words = 2;
+    int max_words = 12;
+    int utf8_percent = 0;  // share of words that are not ASCII
+    int gap = 1;           // step between priorities; 1 is dense
+    unsigned seed = 7;
+};
+
+inline void append_description(std::mt19937& rng, const DatasetSpec& spec, std::string& out) {
+    static const char* const utf8_words[] = {
+        "café", "naïve", "über", "señal", "Ελλάδα", "задача", "日本語", "進捗", "한국어", "🚀", "✓done", "½"
+    };
+    const size_t utf8_count = sizeof(utf8_words) / sizeof(utf8_words[0]);
+    std::uniform_int_distribution<int> words(spec.min_words, spec.max_words);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    const int count = words(rng);
+    for (int w = 0; w < count; w++) {
+        if (w) out += ' ';
+        if (percent(rng) < spec.utf8_percent) {
+            out += utf8_words[rng() % utf8_count];
+        } else {
+            out += "word";
+            out += std::to_string(rng() % 1000);
+        }
+    }
+}
+
+// Writes both lists as the app saves them. Returns false if either file
+// could not be written.
+inline bool write_dataset(const DatasetSpec& spec, const std::string& priority_path, const std::string& regular_path) {
+    std::mt19937 rng(spec.seed);
+    std::string line;
+
+    std::ofstream priority(priority_path);
+    for (size_t i = 0; i < spec.priority_items; i++) {
+        line = std::to_string(1 + static_cast<long long>(i) * spec.gap);
+        line += '|';
+        append_description(rng, spec, line);
+        line += '\n';
+        priority << line;
+    }
+
+    std::ofstream regular(regular_path);
+    for (size_t i = 0; i < spec.regular_items; i++) {
+        line.clear();
+        append_description(rng, spec, line);
+        line += '\n';
+        regular << line;
+    }
+    return static_cast<bool>(priority.flush()) && static_cast<bool>(regular.flush());
+}
+
+#endif
@@ -0,0 +1,101 @@
+#include "binary_store.h"
+#include "todo_file.h"
+#include <cstring>
+
+#define BINARY_MAGIC "TDBS"
+#define BINARY_VERSION 1
+
+bool binstore::load(const std::string& filename, TodoStore& store, std::string& error) {
+    store.clear();
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(filename, false);
+    if (!file->is_open()) return false;
+
+    BinaryHeader header{};
+    if (file->size() < sizeof(header)) {
+        error = "truncated header";
+        return false;
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    if (std::memcmp(header.magic, BINARY_MAGIC, 4) != 0) {
+        error = "not a TODO-BBS store";
+        return false;
+    }
+    if (header.version != BINARY_VERSION) {
+        error = "unsupported version " + std::to_string(header.version);
+        return false;
+    }
+
+    const uint64_t records = static_cast<uint64_t>(header.priority_count) + header.regular_count;
+    const uint64_t table_end = sizeof(header) + records * sizeof(BinaryRecord);
+    // Checked without adding the two, which a crafted header could wrap
+    if (table_end > header.heap_offset || header.heap_offset > file->size()
+        || header.heap_size > file->size() - header.heap_offset) {
+        error = "table or heap out of bounds";
+        return false;
+    }
+
+    store.reserve(records, 0);
+    store.attach_base(file, file->data() + header.heap_offset);
+
+    std::vector<std::pair<int, TodoStore::ItemId>> entries;
+    entries.reserve(header.priority_count);
+
+    const char* table = file->data() + sizeof(header);
+    for (uint64_t i = 0; i < records; i++) {
+        BinaryRecord record{};
+        std::memcpy(&record, table + i * sizeof(record), sizeof(record));
+
+        if (static_cast<uint64_t>(record.offset) + record.length > header.heap_size) {
+            store.clear();
+            error = "record " + std::to_string(i) + " points outside the heap";
+            return false;
+        }
+
+        const bool is_priority = i < header.priority_count;
+        const uint32_t flags = TodoStore::LIVE | (is_priority ? static_cast<uint32_t>(TodoStore::PRIORITY) : 0u);
+        const TodoStore::ItemId id = store.add_external(record.offset, record.length, flags);
+
+        if (is_priority) entries.emplace_back(record.priority, id);
+        else store.append_regular(id);
+    }
+
+    store.assign_priorities(entries);
+    return true;
+}
+
+void binstore::format(const TodoStore& store, std::string& out) {
+    const size_t priority_count = store.priority_items().size();
+    const size_t regular_count = store.regular_items().size();
+
+    BinaryHeader header{};
+    std::memcpy(header.magic, BINARY_MAGIC, 4);
+    header.version = BINARY_VERSION;
+    header.priority_count = static_cast<uint32_t>(priority_count);
+    header.regular_count = static_cast<uint32_t>(regular_count);
+    header.heap_offset = sizeof(header) + (priority_count + regular_count) * sizeof(BinaryRecord);
+
+    std::string heap;
+    std::string table;
+    table.reserve((priority_count + regular_count) * sizeof(BinaryRecord));
+
+    auto add_record = [&](const int priority, const TodoStore::ItemId id) {
+        BinaryRecord record{};
+        record.priority = priority;
+        record.offset = static_cast<uint32_t>(heap.size());
+        record.length = static_cast<uint32_t>(store.description_size(id));
+        heap.append(store.description_data(id), store.description_size(id));
+        table.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    };
+
+    for (const auto& entry : store.priority_items()) add_record(entry.first, entry.second);
+    for (const TodoStore::ItemId id : store.regular_items()) add_record(0, id);
+
+    header.heap_size = heap.size();
+
+    out.reserve(out.size() + sizeof(header) + table.size() + heap.size());
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out += table;
+    out += heap;
+}
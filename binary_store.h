@@ -0,0 +1,43 @@
+#ifndef BINARY_STORE_H
+#define BINARY_STORE_H
+
+#include <cstdint>
+#include <string>
+#include "todo_store.h"
+
+// Optional single-file binary format holding both lists (host byte order):
+//
+//   BinaryHeader
+//   BinaryRecord[priority_count]   priority items, in priority order
+//   BinaryRecord[regular_count]    regular items, in list order
+//   heap                           description bytes
+//
+// Opening one reads only the header and the fixed-width record table. The
+// heap stays mapped and a description is paged in the first time it is shown.
+struct BinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t priority_count;
+    uint32_t regular_count;
+    uint64_t heap_offset;
+    uint64_t heap_size;
+};
+
+struct BinaryRecord {
+    int32_t priority;  // unused for regular items
+    uint32_t flags;    // reserved, written as 0
+    uint32_t offset;   // into the heap
+    uint32_t length;
+};
+
+class binstore {
+public:
+    // Replaces the store's contents with the file's. Returns false if the
+    // file is missing, or when `error` is set, because it is not a valid store.
+    static bool load(const std::string& filename, TodoStore& store, std::string& error);
+
+    // Renders both lists in the binary format into `out`
+    static void format(const TodoStore& store, std::string& out);
+};
+
+#endif
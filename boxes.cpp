@@ -1,156 +1,367 @@
 #include "boxes.h"
 #include "colors.h"
+#include "theme.h"
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define BOXES_HAVE_SSE2 1
+// AVX2 is picked at run time, so it needs only the intrinsics above
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BOXES_HAVE_AVX2 1
+#endif
+#endif
+
+#define ZERO_WIDTH_JOINER 0x200D
+
+struct CodeRange {
+    uint32_t first;
+    uint32_t last;
+};
+
+// Combining marks, joiners, direction marks, variation selectors and emoji
+// modifiers: drawn on top of the previous character
+static const CodeRange zero_width[] = {
+    {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2},
+    {0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x0610, 0x061A}, {0x064B, 0x065F}, {0x0670, 0x0670},
+    {0x06D6, 0x06DC}, {0x06DF, 0x06E4}, {0x06E7, 0x06E8}, {0x06EA, 0x06ED}, {0x0711, 0x0711},
+    {0x0730, 0x074A}, {0x07A6, 0x07B0}, {0x07EB, 0x07F3}, {0x0816, 0x082D}, {0x0859, 0x085B},
+    {0x08D3, 0x08E1}, {0x08E3, 0x0902}, {0x093A, 0x093A}, {0x093C, 0x093C}, {0x0941, 0x0948},
+    {0x094D, 0x094D}, {0x0951, 0x0957}, {0x0962, 0x0963}, {0x0981, 0x0981}, {0x09BC, 0x09BC},
+    {0x09C1, 0x09C4}, {0x09CD, 0x09CD}, {0x09E2, 0x09E3}, {0x0A01, 0x0A02}, {0x0A3C, 0x0A3C},
+    {0x0A41, 0x0A51}, {0x0A70, 0x0A71}, {0x0A75, 0x0A75}, {0x0A81, 0x0A82}, {0x0ABC, 0x0ABC},
+    {0x0AC1, 0x0AC8}, {0x0ACD, 0x0ACD}, {0x0AE2, 0x0AE3}, {0x0B01, 0x0B01}, {0x0B3C, 0x0B3C},
+    {0x0B3F, 0x0B3F}, {0x0B41, 0x0B44}, {0x0B4D, 0x0B4D}, {0x0B56, 0x0B56}, {0x0B82, 0x0B82},
+    {0x0BC0, 0x0BC0}, {0x0BCD, 0x0BCD}, {0x0C3E, 0x0C40}, {0x0C46, 0x0C56}, {0x0CBC, 0x0CBC},
+    {0x0CCC, 0x0CCD}, {0x0D41, 0x0D44}, {0x0D4D, 0x0D4D}, {0x0DCA, 0x0DCA}, {0x0DD2, 0x0DD6},
+    {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x0EB1, 0x0EB1}, {0x0EB4, 0x0EBC},
+    {0x0EC8, 0x0ECD}, {0x0F18, 0x0F19}, {0x0F35, 0x0F35}, {0x0F37, 0x0F37}, {0x0F39, 0x0F39},
+    {0x0F71, 0x0F7E}, {0x0F80, 0x0F84}, {0x0F86, 0x0F87}, {0x0F8D, 0x0FBC}, {0x0FC6, 0x0FC6},
+    {0x102D, 0x1030}, {0x1032, 0x1037}, {0x1039, 0x103A}, {0x1058, 0x1059}, {0x1160, 0x11FF},
+    {0x135D, 0x135F}, {0x1712, 0x1714}, {0x17B4, 0x17B5}, {0x17B7, 0x17BD}, {0x17C6, 0x17C6},
+    {0x17C9, 0x17D3}, {0x17DD, 0x17DD}, {0x180B, 0x180E}, {0x18A9, 0x18A9}, {0x1920, 0x1922},
+    {0x1927, 0x1928}, {0x1932, 0x1932}, {0x1939, 0x193B}, {0x1A17, 0x1A18}, {0x1AB0, 0x1AFF},
+    {0x1B00, 0x1B03}, {0x1B34, 0x1B34}, {0x1B36, 0x1B3A}, {0x1B3C, 0x1B3C}, {0x1B42, 0x1B42},
+    {0x1B6B, 0x1B73}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x202A, 0x202E}, {0x2060, 0x2064},
+    {0x20D0, 0x20F0}, {0x2CEF, 0x2CF1}, {0x2DE0, 0x2DFF}, {0x302A, 0x302D}, {0x3099, 0x309A},
+    {0xA66F, 0xA672}, {0xA674, 0xA67D}, {0xA69E, 0xA69F}, {0xA6F0, 0xA6F1}, {0xA802, 0xA802},
+    {0xA806, 0xA806}, {0xA80B, 0xA80B}, {0xA825, 0xA826}, {0xA8C4, 0xA8C5}, {0xA8E0, 0xA8F1},
+    {0xFB1E, 0xFB1E}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}, {0x101FD, 0x101FD},
+    {0x10A01, 0x10A0F}, {0x10A38, 0x10A3F}, {0x1D167, 0x1D169}, {0x1D173, 0x1D182},
+    {0x1D185, 0x1D18B}, {0x1D1AA, 0x1D1AD}, {0x1F3FB, 0x1F3FF}, {0xE0001, 0xE0001},
+    {0xE0020, 0xE007F}, {0xE0100, 0xE01EF}
+};
+
+// East Asian wide and fullwidth characters and emoji shown as pictures:
+// two columns each
+static const CodeRange wide[] = {
+    {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0},
+    {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F},
+    {0x2693, 0x2693}, {0x26A1, 0x26A1}, {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5},
+    {0x26CE, 0x26CE}, {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B}, {0x2728, 0x2728},
+    {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797},
+    {0x27B0, 0x27B0}, {0x27BF, 0x27BF}, {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55},
+    {0x2E80, 0x303E}, {0x3041, 0x4DBF}, {0x4E00, 0xA4CF}, {0xA960, 0xA97F}, {0xAC00, 0xD7A3},
+    {0xF900, 0xFAFF}, {0xFE10, 0xFE19}, {0xFE30, 0xFE6F}, {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6},
+    {0x16FE0, 0x16FE4}, {0x17000, 0x18AFF}, {0x1B000, 0x1B16F}, {0x1F004, 0x1F004},
+    {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F202},
+    {0x1F210, 0x1F23B}, {0x1F240, 0x1F248}, {0x1F250, 0x1F251}, {0x1F260, 0x1F265},
+    {0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF}, {0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F9FF},
+    {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD}
+};
+
+template <size_t N>
+static bool in_table(const uint32_t cp, const CodeRange (&table)[N]) {
+    size_t low = 0, high = N;
+    while (low < high) {
+        const size_t mid = (low + high) / 2;
+        if (table[mid].last < cp) low = mid + 1;
+        else high = mid;
+    }
+    return low < N && table[low].first <= cp;
+}
 
-// Helper function to calculate the visible length of a string (excluding ANSI codes)
-// Properly handles UTF-8 multibyte characters
-size_t visible_length(const std::string& str) {
+// Columns taken by one code point. Everything below U+0300 is one column,
+// which is what lets the vector scanners count those without decoding.
+static size_t codepoint_width(const uint32_t cp) {
+    if (cp < 0x300) return 1;
+    if (in_table(cp, zero_width)) return 0;
+    if (in_table(cp, wide)) return 2;
+    return 1;
+}
+
+// Consumes one escape sequence or UTF-8 character at s[i] and returns its
+// width. A character after a zero width joiner is part of the same glyph
+// (emoji sequences), so it adds nothing.
+static size_t width_step(const unsigned char* s, const size_t n, size_t& i, bool& joined) {
+    const unsigned char c = s[i];
+
+    // ANSI escape sequence: skip through the closing 'm'
+    if (c == '\033') {
+        const void* m = std::memchr(s + i + 1, 'm', n - i - 1);
+        i = m ? static_cast<size_t>(static_cast<const unsigned char*>(m) - s) + 1 : n;
+        return 0;
+    }
+
+    // Stray continuation byte
+    if ((c & 0xC0) == 0x80) {
+        i++;
+        return 0;
+    }
+
+    // Decode the lead byte and as many of its continuation bytes as follow:
+    // 0xxxxxxx, 110xxxxx, 1110xxxx and 11110xxx start 1 to 4 byte characters
+    size_t extra = 0;
+    uint32_t cp = c;
+    if ((c & 0xE0) == 0xC0) { extra = 1; cp = c & 0x1F; }
+    else if ((c & 0xF0) == 0xE0) { extra = 2; cp = c & 0x0F; }
+    else if ((c & 0xF8) == 0xF0) { extra = 3; cp = c & 0x07; }
+    else if (c >= 0x80) cp = 0xFFFD;  // invalid lead byte
+    i++;
+    while (extra-- > 0 && i < n && (s[i] & 0xC0) == 0x80) cp = (cp << 6) | (s[i++] & 0x3F);
+
+    const size_t width = joined ? 0 : codepoint_width(cp);
+    joined = cp == ZERO_WIDTH_JOINER;
+    return width;
+}
+
+static size_t width_scalar(const unsigned char* s, const size_t n) {
     size_t len = 0;
-    bool in_escape = false;
+    bool joined = false;
+    for (size_t i = 0; i < n; ) len += width_step(s, n, i, joined);
+    return len;
+}
 
-    for (size_t i = 0; i < str.length(); ) {
-        const unsigned char c = str[i];
+// The vector scanners take a block at a time while it holds nothing but
+// ASCII, continuation bytes and lead bytes below 0xCC (U+0000 to U+02FF, all
+// one column), so the width is the count of non-continuation bytes. Escapes
+// and other characters go through width_step.
+#ifdef BOXES_HAVE_SSE2
+static size_t width_sse2(const unsigned char* s, const size_t n) {
+    const __m128i escape = _mm_set1_epi8('\033');
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i below_lead = _mm_set1_epi8(static_cast<char>(0xCB));
+    const __m128i below_lead_min = _mm_set1_epi8(static_cast<char>(0xC0));
 
-        // Check for ANSI escape sequence
-        if (c == '\033') {
-            in_escape = true;
-            i++;
-            continue;
+    size_t len = 0;
+    bool joined = false;
+    for (size_t i = 0; i < n; ) {
+        if (!joined && n - i >= 16) {
+            // As signed bytes, 0x80-0xBF sort below 0xC0 and 0xCC-0xFF above 0xCB
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            const __m128i high = _mm_and_si128(_mm_cmpgt_epi8(chunk, below_lead), _mm_cmplt_epi8(chunk, zero));
+            const unsigned special = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(high, _mm_cmpeq_epi8(chunk, escape))));
+            const unsigned continuation = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmplt_epi8(chunk, below_lead_min)));
+
+            if (!special) {
+                len += 16 - __builtin_popcount(continuation);
+                i += 16;
+                continue;
+            }
+            const unsigned prefix = __builtin_ctz(special);
+            len += prefix - __builtin_popcount(continuation & ((1u << prefix) - 1));
+            i += prefix;
         }
+        len += width_step(s, n, i, joined);
+    }
+    return len;
+}
+#endif
 
-        if (in_escape) {
-            if (c == 'm') {
-                in_escape = false;
+#ifdef BOXES_HAVE_AVX2
+__attribute__((target("avx2")))
+static size_t width_avx2(const unsigned char* s, const size_t n) {
+    const __m256i escape = _mm256_set1_epi8('\033');
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i below_lead = _mm256_set1_epi8(static_cast<char>(0xCB));
+    const __m256i below_lead_min = _mm256_set1_epi8(static_cast<char>(0xC0));
+
+    size_t len = 0;
+    bool joined = false;
+    for (size_t i = 0; i < n; ) {
+        if (!joined && n - i >= 32) {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+            const __m256i high = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, below_lead), _mm256_cmpgt_epi8(zero, chunk));
+            const unsigned special = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(high, _mm256_cmpeq_epi8(chunk, escape))));
+            const unsigned continuation = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(below_lead_min, chunk)));
+
+            if (!special) {
+                len += 32 - __builtin_popcount(continuation);
+                i += 32;
+                continue;
             }
-            i++;
-            continue;
+            const unsigned prefix = __builtin_ctz(special);
+            len += prefix - __builtin_popcount(continuation & ((1u << prefix) - 1));
+            i += prefix;
         }
+        len += width_step(s, n, i, joined);
+    }
+    return len;
+}
+#endif
+
+typedef size_t (*WidthFn)(const unsigned char*, size_t);
+
+static WidthFn select_width() {
+#ifdef BOXES_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return width_avx2;
+#endif
+#ifdef BOXES_HAVE_SSE2
+    return width_sse2;
+#else
+    return width_scalar;
+#endif
+}
 
-        // Count UTF-8 characters
-        // UTF-8 character lengths:
-        // 0xxxxxxx = 1 byte (ASCII)
-        // 110xxxxx = 2 bytes
-        // 1110xxxx = 3 bytes
-        // 11110xxx = 4 bytes
-        if ((c & 0x80) == 0) {
-            // 1-byte character (ASCII)
-            i += 1;
-        } else if ((c & 0xE0) == 0xC0) {
-            // 2-byte character
-            i += 2;
-        } else if ((c & 0xF0) == 0xE0) {
-            // 3-byte character
-            i += 3;
-        } else if ((c & 0xF8) == 0xF0) {
-            // 4-byte character
-            i += 4;
-        } else {
-            // Invalid UTF-8, just skip this byte
-            i += 1;
-        }
+size_t visible_length(const char* str, const size_t length) {
+    static const WidthFn impl = select_width();
+    return impl(reinterpret_cast<const unsigned char*>(str), length);
+}
 
-        len++;
-    }
+size_t visible_length(const std::string& str) {
+    return visible_length(str.data(), str.size());
+}
 
-    return len;
+size_t visible_length_scalar(const std::string& str) {
+    return width_scalar(reinterpret_cast<const unsigned char*>(str.data()), str.size());
 }
 
 u_long boxes::padding(const u_long length, const u_long size) {
     return (size - length + PADDING) / 2;
 }
 
-std::string boxes::box(std::string header, const std::vector<std::string>& contents, const std::string& bodyColor, const std::string& barColor)
+// Bars for any border up to this wide are one append out of a run laid out
+// at compile time; wider ones take one per BAR_RUN
+#define BAR_RUN 256
+static constexpr auto bar_run = repeat<BAR_RUN>("═");
+
+// Appends `count` copies of the 3-byte bar glyph
+static void append_bars(std::string& out, u_long count) {
+    const size_t glyph = bar_run.size() / BAR_RUN;
+    while (count > 0) {
+        const u_long run = std::min<u_long>(count, BAR_RUN);
+        out.append(bar_run.data(), run * glyph);
+        count -= run;
+    }
+}
+
+// The one box renderer behind every overload. Each line is measured once
+// (or not at all when `known` widths are given), the output size is worked
+// out up front, and the box is written straight into `out` with `prefix` in
+// front of every line. Returns the inner width used.
+static u_long render_box(std::string& out, const std::string& title, const std::string* lines, const size_t count,
+                         const std::string_view bodyColor, const std::string_view barColor, const std::string_view reset,
+                         const std::string_view prefix, const u_long min_header_pad,
+                         const u_long* known = nullptr, const u_long min_width = 0)
 {
-    if (!header.empty()) header = " " + header + " ";
+    static thread_local std::vector<u_long> measured;
+    const u_long* widths = known;
+    if (!widths) {
+        measured.resize(count);
+        for (size_t i = 0; i < count; i++) measured[i] = visible_length(lines[i]);
+        widths = measured.data();
+    }
 
     u_long max_len = 0;
-    for (const auto& line : contents) {
-        const u_long line_len = visible_length(line);
-        if (line_len > max_len) max_len = line_len;
+    size_t line_bytes = 0;
+    u_long width_sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (widths[i] > max_len) max_len = widths[i];
+        line_bytes += lines[i].size();
+        width_sum += widths[i];
     }
 
-    const u_long content_max = (visible_length(header) > max_len) ? visible_length(header) : max_len;
-    const u_long total_inner_width = content_max + PADDING;
-
-    // Ensure minimum header padding if we have a header
-    u_long actual_width = total_inner_width;
-    if (!header.empty()) {
-        constexpr u_long min_header_pad = 3;
-        const u_long min_width_for_header = visible_length(header) + (min_header_pad * 2);
-        if (min_width_for_header > actual_width) {
-            actual_width = min_width_for_header;
-        }
+    // The title is shown with a space either side
+    const u_long title_width = title.empty() ? 0 : visible_length(title) + 2;
+    u_long width = std::max(title_width, max_len) + PADDING;
+    if (!title.empty()) width = std::max(width, title_width + min_header_pad * 2);
+    width = std::max(width, min_width);
+
+    const size_t edge = 3;  // bytes in one box-drawing glyph
+    const size_t rows = count + 2;
+    out.reserve(out.size()
+                + rows * (prefix.size() + 2 * edge + 1)
+                + (rows + 1) * reset.size() + 2 * barColor.size() + count * bodyColor.size()
+                + (2 * width - title_width) * edge + (title.empty() ? 0 : title.size() + 2)
+                + line_bytes + count * width - width_sum);
+
+    out += prefix;
+    out += barColor;
+    out += "╔";
+    if (title.empty()) {
+        append_bars(out, width);
+    } else {
+        const u_long left_pad = (width - title_width) / 2;
+        append_bars(out, left_pad);
+        out += ' ';
+        out += title;
+        out += ' ';
+        append_bars(out, width - title_width - left_pad);
     }
-
-    std::string fin;
-    if (header.empty()) fin += barColor + boxes::header(actual_width) + RESET;
-    else fin += barColor + namedHeader(header, actual_width) + RESET;
-
-    for (const auto& line : contents) {
-        fin += bodyColor + spacedContent(line, actual_width) + RESET;
+    out += "╗\n";
+
+    for (size_t i = 0; i < count; i++) {
+        const u_long left_pad = (width - widths[i]) / 2;
+        out += prefix;
+        out += reset;
+        out += bodyColor;
+        out += "│";
+        out.append(left_pad, ' ');
+        out += lines[i];
+        out.append(width - widths[i] - left_pad, ' ');
+        out += "│\n";
     }
 
-    fin += barColor + footer(actual_width) + RESET;
-    return fin;
+    out += prefix;
+    out += reset;
+    out += barColor;
+    out += "╚";
+    append_bars(out, width);
+    out += "╝\n";
+    out += reset;
+    return width;
 }
 
-std::string boxes::box(std::string header, const std::vector<std::string>& contents)
-{
-    if (!header.empty()) header = " " + header + " ";
-
-    u_long max_len = 0;
-    for (const auto& line : contents) {
-        const u_long line_len = visible_length(line);
-        if (line_len > max_len) max_len = line_len;
-    }
+// Minimum run of bars either side of a box title
+#define MIN_HEADER_PAD 3
 
-    const u_long content_max = (visible_length(header) > max_len) ? visible_length(header) : max_len;
-    const u_long total_inner_width = content_max + PADDING;
+void boxes::render(std::string& out, const std::string& header, const std::vector<std::string>& contents,
+                   const std::string_view bodyColor, const std::string_view barColor, const std::string_view prefix)
+{
+    render_box(out, header, contents.data(), contents.size(), bodyColor, barColor, RESET, prefix, MIN_HEADER_PAD);
+}
 
-    // Ensure minimum header padding if we have a header
-    u_long actual_width = total_inner_width;
-    if (!header.empty()) {
-        constexpr u_long min_header_pad = 3;
-        const u_long min_width_for_header = visible_length(header) + (min_header_pad * 2);
-        if (min_width_for_header > actual_width) {
-            actual_width = min_width_for_header;
-        }
-    }
+u_long boxes::render(std::string& out, const std::string& header, const std::vector<std::string>& contents,
+                     const std::vector<u_long>& widths, const u_long min_width,
+                     const std::string_view bodyColor, const std::string_view barColor, const std::string_view prefix)
+{
+    return render_box(out, header, contents.data(), contents.size(), bodyColor, barColor, RESET, prefix, MIN_HEADER_PAD,
+                      widths.data(), min_width);
+}
 
+std::string boxes::box(const std::string& header, const std::vector<std::string>& contents, const std::string_view bodyColor, const std::string_view barColor)
+{
     std::string fin;
-    if (header.empty()) fin += boxes::header(actual_width);
-    else fin += namedHeader(header, actual_width);
-
-    for (const auto& line : contents) {
-        fin += spacedContent(line, actual_width);
-    }
-
-    fin += footer(actual_width);
+    render_box(fin, header, contents.data(), contents.size(), bodyColor, barColor, RESET, "", MIN_HEADER_PAD);
     return fin;
 }
 
-std::string boxes::box(std::string header, const std::string& body) {
-    if (!header.empty()) header = ' ' + header + ' ';
+std::string boxes::box(const std::string& header, const std::vector<std::string>& contents)
+{
     std::string fin;
-    const u_long content_max = visible_length(header) > visible_length(body) ? visible_length(header) : visible_length(body);
-    const u_long total_inner_width = content_max + PADDING;
-
-    if (header.empty()) fin += boxes::header(total_inner_width);
-    else fin += namedHeader(header, total_inner_width);
-
-    fin += spacedContent(body, total_inner_width);
-    fin += footer(total_inner_width);
-
+    render_box(fin, header, contents.data(), contents.size(), "", "", "", "", MIN_HEADER_PAD);
     return fin;
 }
 
-// Helper function to repeat a string
-std::string repeat(const std::string& s, const size_t n) {
-    std::string res;
-    res.reserve(s.length() * n);
-    for (size_t i = 0; i < n; ++i) res += s;
-    return res;
+std::string boxes::box(const std::string& header, const std::string& body) {
+    std::string fin;
+    render_box(fin, header, &body, 1, "", "", "", "", 0);
+    return fin;
 }
 
 std::string boxes::spacedContent(const std::string& toSpace, const u_long size) {
@@ -166,35 +377,43 @@ std::string boxes::namedHeader(const std::string& toSpace, const u_long size) {
     const u_long left_pad = (size - visible_len) / 2;
     const u_long right_pad = size - visible_len - left_pad;
 
-    return "╔" + repeat("═", left_pad) + toSpace + repeat("═", right_pad) + "╗\n";
+    std::string line = "╔";
+    append_bars(line, left_pad);
+    line += toSpace;
+    append_bars(line, right_pad);
+    return line + "╗\n";
 }
 
 std::string boxes::header(const u_long length) {
-    return "╔" + repeat("═", length) + "╗\n";
+    std::string line = "╔";
+    append_bars(line, length);
+    return line + "╗\n";
 }
 
 std::string boxes::footer(const u_long size) {
-    return "╚" + repeat("═", size) + "╝\n";
+    std::string line = "╚";
+    append_bars(line, size);
+    return line + "╝\n";
 }
 
 std::string boxes::indent(const std::string& text, const std::string& prefix) {
     std::string result;
-    std::string line;
+    result.reserve(text.size() + prefix.size() * static_cast<size_t>(std::count(text.begin(), text.end(), '\n') + 1));
 
-    for (const char c : text) {
-        line += c;
-        if (c == '\n') {
-            result += prefix + line;
-            line.clear();
-        }
+    size_t start = 0;
+    for (size_t end = text.find('\n'); end != std::string::npos; end = text.find('\n', start)) {
+        result += prefix;
+        result.append(text, start, end + 1 - start);
+        start = end + 1;
     }
 
     // Don't add prefix to trailing escape codes or empty content
-    if (!line.empty()) {
+    if (start < text.size()) {
         // Check if line contains only escape sequences (no visible content)
         bool has_visible = false;
         bool in_escape = false;
-        for (char c : line) {
+        for (size_t i = start; i < text.size(); i++) {
+            const char c = text[i];
             if (c == '\033') {
                 in_escape = true;
             } else if (in_escape && c == 'm') {
@@ -207,12 +426,9 @@ std::string boxes::indent(const std::string& text, const std::string& prefix) {
 
         // Only add the remaining line if it has visible content,
         // otherwise just append it without prefix
-        if (has_visible) {
-            result += prefix + line;
-        } else {
-            result += line;
-        }
+        if (has_visible) result += prefix;
+        result.append(text, start, std::string::npos);
     }
 
     return result;
-}
\ No newline at end of file
+}
@@ -2,16 +2,32 @@
 #define BOXES_H
 
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <vector>
 #define PADDING 2
 
+// Number of terminal columns `str` takes up, skipping ANSI color codes.
+// UTF-8 aware: wide (CJK, emoji) characters count 2, combining marks and
+// anything joined on by a zero width joiner count 0. Vectorized (AVX2 or
+// SSE2, picked at runtime).
+size_t visible_length(const std::string& str);
+size_t visible_length(const char* str, size_t length);
+// The plain byte-at-a-time version, kept as the reference
+size_t visible_length_scalar(const std::string& str);
+
 class boxes {
 public:
     static u_long padding(u_long length, u_long size);
-    static std::string box(std::string header, const std::string& body);
-    static std::string box(std::string header, const std::vector<std::string>& contents, const std::string& bodyColor, const std::string& barColor);
-    static std::string box(std::string header, const std::vector<std::string>& contents);
+    static std::string box(const std::string& header, const std::string& body);
+    static std::string box(const std::string& header, const std::vector<std::string>& contents, std::string_view bodyColor, std::string_view barColor);
+    static std::string box(const std::string& header, const std::vector<std::string>& contents);
+    // Appends the colored box to `out` with `prefix` before every line; the
+    // same text as indent(box(...), prefix) without the intermediate copies
+    static void render(std::string& out, const std::string& header, const std::vector<std::string>& contents, std::string_view bodyColor, std::string_view barColor, std::string_view prefix);
+    // As above, for lines whose widths are already known. The box is made at
+    // least `min_width` wide; returns the width it used.
+    static u_long render(std::string& out, const std::string& header, const std::vector<std::string>& contents, const std::vector<u_long>& widths, u_long min_width, std::string_view bodyColor, std::string_view barColor, std::string_view prefix);
     static std::string spacedContent(const std::string& toSpace, u_long size);
     static std::string namedHeader(const std::string& toSpace, u_long size);
     static std::string header(u_long length);
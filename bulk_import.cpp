@@ -0,0 +1,223 @@
+#include "bulk_import.h"
+#include "todo_file.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Input handed to a worker at a time; small enough to spread a file of a
+// few tens of MB across every core
+#define CHUNK_BYTES (1024 * 1024)
+
+// Existing descriptions hashed per job
+#define HASH_BATCH 65536
+
+namespace {
+
+// A description wherever its bytes are, hashed once
+struct Key {
+    const char* desc;
+    size_t length;
+    uint64_t hash;
+};
+
+// Open-addressed set of descriptions: one flat slot array probed linearly,
+// each slot the hash and the position of the key it holds. Far fewer cache
+// misses per insert than a node-based set.
+class KeySet {
+public:
+    explicit KeySet(const size_t capacity) {
+        size_t size = 16;
+        while (size < capacity * 2) size *= 2;
+        slots.assign(size, Slot{0, nullptr});
+        mask = size - 1;
+    }
+
+    // False if an equal description is already in the set
+    bool insert(const Key& key) {
+        for (size_t i = static_cast<size_t>(key.hash) & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (!slot.key) {
+                slot.hash = key.hash;
+                slot.key = &key;
+                return true;
+            }
+            if (slot.hash == key.hash && slot.key->length == key.length
+                && std::memcmp(slot.key->desc, key.desc, key.length) == 0) {
+                return false;
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        uint64_t hash;
+        const Key* key;  // owned by the caller, must outlive the set
+    };
+    std::vector<Slot> slots;
+    size_t mask;
+};
+
+struct Parsed {
+    Key key;
+    int priority;
+};
+
+typedef std::pair<const char*, const char*> Chunk;
+
+// FNV-1a
+uint64_t hash_bytes(const char* p, const size_t length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(p[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Runs job(i) for every i below `count` on up to one thread per core,
+// each pulling the next index from a shared counter until none are left
+template <typename Job>
+void run_pool(const size_t count, const Job& job) {
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    const size_t workers = std::min(count, cores);
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t i = next++; i < count; i = next++) job(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < workers; t++) threads.emplace_back(work);
+    work();
+    for (std::thread& thread : threads) thread.join();
+}
+
+// Cuts the file into runs of about CHUNK_BYTES, each ending after a newline
+void split(const MappedFile& file, std::vector<Chunk>& chunks) {
+    const char* p = file.data();
+    const char* const end = p + file.size();
+    while (p < end) {
+        const char* stop = static_cast<size_t>(end - p) > CHUNK_BYTES ? p + CHUNK_BYTES : end;
+        if (stop != end) {
+            stop = todofile::find(stop, end, '\n');
+            if (stop != end) ++stop;
+        }
+        chunks.emplace_back(p, stop);
+        p = stop;
+    }
+}
+
+// Same rules as todofile::load: blank lines are skipped, and so are
+// priority lines without a '|' or a number in front of it
+void parse(const Chunk& chunk, const bool is_priority, std::vector<Parsed>& out) {
+    const char* p = chunk.first;
+    const char* const end = chunk.second;
+
+    while (p < end) {
+        const char* eol = todofile::find(p, end, '\n');
+
+        if (eol != p) {
+            Parsed item;
+            item.priority = 0;
+            item.key.desc = p;
+            if (is_priority) {
+                const char* bar = todofile::find(p, eol, '|');
+                if (bar != eol && todofile::parse_priority(p, bar, item.priority)) item.key.desc = bar + 1;
+                else item.key.desc = nullptr;
+            }
+            if (item.key.desc) {
+                item.key.length = static_cast<size_t>(eol - item.key.desc);
+                item.key.hash = hash_bytes(item.key.desc, item.key.length);
+                out.push_back(item);
+            }
+        }
+
+        p = eol == end ? end : eol + 1;
+    }
+}
+
+void parse_file(const MappedFile& file, const bool is_priority, std::vector<std::vector<Parsed>>& parsed) {
+    std::vector<Chunk> chunks;
+    split(file, chunks);
+    parsed.resize(chunks.size());
+    run_pool(chunks.size(), [&](const size_t i) { parse(chunks[i], is_priority, parsed[i]); });
+}
+
+// Keeps the items whose descriptions `seen` does not have yet, in file order
+void keep_new(const std::vector<std::vector<Parsed>>& parsed, KeySet& seen,
+              std::vector<TodoSession::ImportItem>& out, bulkimport::Report& report) {
+    for (const std::vector<Parsed>& chunk : parsed) {
+        report.read += chunk.size();
+        for (const Parsed& item : chunk) {
+            if (seen.insert(item.key)) out.push_back({item.priority, item.key.desc, item.key.length});
+            else report.duplicates++;
+        }
+    }
+}
+
+}
+
+bool bulkimport::merge(TodoSession& session, const std::string& priority_file, const std::string& regular_file,
+                       Report& report, std::string& error) {
+    const auto start = std::chrono::steady_clock::now();
+    report = Report();
+
+    // Both files stay mapped until their items are copied into the store
+    std::unique_ptr<MappedFile> files[2];
+    const std::string* paths[2] = {&priority_file, &regular_file};
+    for (int i = 0; i < 2; i++) {
+        if (paths[i]->empty()) continue;
+        files[i].reset(new MappedFile(*paths[i]));
+        if (!files[i]->is_open()) {
+            error = "Could not open " + *paths[i];
+            return false;
+        }
+    }
+
+    std::vector<std::vector<Parsed>> parsed[2];
+    for (int i = 0; i < 2; i++) {
+        if (files[i]) parse_file(*files[i], i == 0, parsed[i]);
+    }
+
+    // Hash what the lists already hold, a batch of items per job. The keys
+    // point into the store, which is left alone until the set is done with.
+    const TodoStore& store = session.lists();
+    std::vector<TodoStore::ItemId> ids;
+    ids.reserve(store.priority_items().size() + store.regular_items().size());
+    for (const auto& entry : store.priority_items()) ids.push_back(entry.second);
+    ids.insert(ids.end(), store.regular_items().begin(), store.regular_items().end());
+
+    std::vector<Key> existing(ids.size());
+    run_pool((ids.size() + HASH_BATCH - 1) / HASH_BATCH, [&](const size_t batch) {
+        const size_t stop = std::min(ids.size(), (batch + 1) * HASH_BATCH);
+        for (size_t i = batch * HASH_BATCH; i < stop; i++) {
+            existing[i].desc = store.description_data(ids[i]);
+            existing[i].length = store.description_size(ids[i]);
+            existing[i].hash = hash_bytes(existing[i].desc, existing[i].length);
+        }
+    });
+
+    size_t incoming = 0;
+    for (const auto& file : parsed) {
+        for (const std::vector<Parsed>& chunk : file) incoming += chunk.size();
+    }
+
+    KeySet seen(existing.size() + incoming);
+    for (const Key& key : existing) seen.insert(key);
+
+    std::vector<TodoSession::ImportItem> priority_items, regular_items;
+    keep_new(parsed[0], seen, priority_items, report);
+    keep_new(parsed[1], seen, regular_items, report);
+
+    session.import_priority(priority_items);
+    session.import_regular(regular_items);
+    report.added = priority_items.size() + regular_items.size();
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef BULK_IMPORT_H
+#define BULK_IMPORT_H
+
+#include <string>
+#include "todo_session.h"
+
+// Merges exported list files (the same format as priority_todo.txt and
+// regular_todo.txt) into a session. Each file is mapped and cut into chunks
+// at line boundaries; a pool of threads parses and hashes the chunks, and
+// any description already in either list, or earlier in the import, is
+// dropped. What is left goes in through TodoSession::import_priority and
+// import_regular, so conflicting priorities are bumped in a single pass.
+class bulkimport {
+public:
+    struct Report {
+        size_t read = 0;        // lines that parsed as items
+        size_t duplicates = 0;  // of those, already present
+        size_t added = 0;
+        double seconds = 0;
+    };
+
+    // Either path may be empty to skip that list. Returns false (with
+    // `error`) if a file cannot be opened; nothing is added in that case.
+    static bool merge(TodoSession& session, const std::string& priority_file, const std::string& regular_file,
+                      Report& report, std::string& error);
+};
+
+#endif
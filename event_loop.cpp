@@ -0,0 +1,330 @@
+#include "event_loop.h"
+#include "boxes.h"
+#include "output.h"
+#include <algorithm>
+#include <iostream>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <csignal>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <termios.h>
+    #include <unistd.h>
+#endif
+
+// How long the rest of an escape sequence may take to arrive before the
+// ESC that started it counts as a key of its own
+#define ESCAPE_WAIT_MS 30
+
+// next_byte() found nothing before its timeout
+#define NO_INPUT (-4)
+
+#define CTRL_D 4
+
+namespace {
+    #ifndef _WIN32
+        // Shared with the signal handlers. There is only ever one loop, the
+        // one that owns the terminal.
+        termios saved_mode;
+        volatile sig_atomic_t mode_saved = 0;
+        volatile sig_atomic_t resized = 0;
+        int wake_read = -1;
+        int wake_write = -1;
+
+        // Puts the terminal back before dying of `sig`
+        void restore_and_raise(const int sig) {
+            if (mode_saved) tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_mode);
+            signal(sig, SIG_DFL);
+            raise(sig);
+        }
+
+        void note_resize(int) {
+            const int saved_errno = errno;
+            resized = 1;
+            const char byte = 0;
+            if (wake_write >= 0 && write(wake_write, &byte, 1) < 0) {}
+            errno = saved_errno;
+        }
+    #endif
+}
+
+EventLoop::EventLoop()
+    : last_timer(0), redraw_pending(false), resize_pending(false), raw(false), input_ended(false),
+      skip_line_end(false) {
+    #ifndef _WIN32
+        int fds[2];
+        if (pipe(fds) == 0) {
+            for (const int fd : fds) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+            wake_read = fds[0];
+            wake_write = fds[1];
+        }
+
+        if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved_mode) == 0) {
+            termios mode = saved_mode;
+            mode.c_lflag &= ~(ICANON | ECHO);  // ISIG stays, so Ctrl-C still works
+            mode.c_cc[VMIN] = 1;
+            mode.c_cc[VTIME] = 0;
+            mode_saved = 1;
+            for (const int sig : {SIGINT, SIGTERM, SIGHUP, SIGQUIT}) signal(sig, restore_and_raise);
+            raw = tcsetattr(STDIN_FILENO, TCSAFLUSH, &mode) == 0;
+        }
+        signal(SIGWINCH, note_resize);
+    #endif
+}
+
+EventLoop::~EventLoop() {
+    output::flush();
+    #ifndef _WIN32
+        signal(SIGWINCH, SIG_DFL);
+        if (mode_saved) {
+            tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_mode);
+            for (const int sig : {SIGINT, SIGTERM, SIGHUP, SIGQUIT}) signal(sig, SIG_DFL);
+            mode_saved = 0;
+        }
+        if (wake_read >= 0) {
+            close(wake_read);
+            close(wake_write);
+            wake_read = wake_write = -1;
+        }
+    #endif
+}
+
+namespace {
+    // Orders the timer heap soonest first
+    struct Later {
+        template <typename Timer>
+        bool operator()(const Timer& a, const Timer& b) const { return a.due > b.due; }
+    };
+}
+
+unsigned long EventLoop::after(const int delay_ms, Task task, const bool repeat) {
+    const int delay = std::max(delay_ms, 0);
+    timers.push_back(Timer{std::chrono::steady_clock::now() + std::chrono::milliseconds(delay), ++last_timer,
+                           repeat ? std::max(delay, 1) : 0, std::move(task)});
+    std::push_heap(timers.begin(), timers.end(), Later());
+    return last_timer;
+}
+
+void EventLoop::cancel(const unsigned long timer) {
+    const auto found = std::find_if(timers.begin(), timers.end(), [timer](const Timer& t) { return t.id == timer; });
+    if (found == timers.end()) return;
+    timers.erase(found);
+    std::make_heap(timers.begin(), timers.end(), Later());
+}
+
+void EventLoop::watch(const int fd, Task task) {
+    watched.emplace_back(fd, std::move(task));
+}
+
+void EventLoop::post(Task task) {
+    {
+        std::lock_guard<std::mutex> guard(posted_lock);
+        posted.push_back(std::move(task));
+    }
+    #ifndef _WIN32
+        const char byte = 0;
+        if (wake_write >= 0 && write(wake_write, &byte, 1) < 0) {}
+    #endif
+}
+
+void EventLoop::run_due() {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> guard(posted_lock);
+        tasks.swap(posted);
+    }
+    for (Task& task : tasks) task();
+
+    const auto now = std::chrono::steady_clock::now();
+    while (!timers.empty() && timers.front().due <= now) {
+        std::pop_heap(timers.begin(), timers.end(), Later());
+        Timer timer = std::move(timers.back());
+        timers.pop_back();
+
+        // Rescheduled before it runs, so it may cancel itself
+        if (timer.period_ms > 0) {
+            timers.push_back(Timer{now + std::chrono::milliseconds(timer.period_ms), timer.id, timer.period_ms, timer.task});
+            std::push_heap(timers.begin(), timers.end(), Later());
+        }
+        timer.task();
+    }
+}
+
+// One byte of input, running tasks and timers until there is one. Gives
+// up with NO_INPUT after `timeout_ms` unless that is negative, and stops
+// early for a redraw if `allow_redraw`.
+int EventLoop::next_byte(const bool allow_redraw, const int timeout_ms) {
+    using std::chrono::steady_clock;
+    const steady_clock::time_point deadline = timeout_ms < 0
+        ? steady_clock::time_point::max()
+        : steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    while (true) {
+        if (!pending_input.empty()) {
+            const int byte = static_cast<unsigned char>(pending_input[0]);
+            pending_input.erase(0, 1);
+            // "\n", "\r" or "\r\n" after a choice()
+            if (skip_line_end && (byte == '\n' || byte == '\r')) {
+                skip_line_end = byte == '\r';
+                continue;
+            }
+            skip_line_end = false;
+            return byte;
+        }
+        if (input_ended) return KEY_EOF;
+
+        run_due();
+        #ifndef _WIN32
+            if (resized) {
+                resized = 0;
+                resize_pending = true;
+            }
+        #endif
+        if (allow_redraw && resize_pending) {
+            resize_pending = redraw_pending = false;
+            return KEY_RESIZE;
+        }
+        if (allow_redraw && redraw_pending) {
+            redraw_pending = false;
+            return KEY_REDRAW;
+        }
+
+        const steady_clock::time_point now = steady_clock::now();
+        if (now >= deadline) return NO_INPUT;
+        steady_clock::time_point wake = deadline;
+        if (!timers.empty()) wake = std::min(wake, timers.front().due);
+
+        #ifdef _WIN32
+            // No poll() on console handles: input is read as typed lines
+            // through std::cin, and timers only run between keys
+            if (timeout_ms >= 0) return NO_INPUT;
+            const int byte = std::cin.get();
+            if (byte == std::char_traits<char>::eof()) input_ended = true;
+            else pending_input.push_back(static_cast<char>(byte));
+        #else
+            int wait_ms = -1;
+            if (wake != steady_clock::time_point::max()) {
+                wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count()) + 1;
+            }
+
+            std::vector<pollfd> fds;
+            fds.push_back(pollfd{STDIN_FILENO, POLLIN, 0});
+            if (wake_read >= 0) fds.push_back(pollfd{wake_read, POLLIN, 0});
+            const size_t first_watched = fds.size();
+            for (const auto& entry : watched) fds.push_back(pollfd{entry.first, POLLIN, 0});
+
+            if (poll(fds.data(), fds.size(), wait_ms) < 0) {
+                if (errno == EINTR) continue;
+                input_ended = true;
+                continue;
+            }
+
+            if (wake_read >= 0 && fds[1].revents) {
+                char drain[64];
+                while (read(wake_read, drain, sizeof(drain)) > 0) {}
+            }
+            const std::vector<std::pair<int, Task>> watching = watched;
+            for (size_t i = first_watched; i < fds.size(); i++) {
+                if (fds[i].revents) watching[i - first_watched].second();
+            }
+
+            if (fds[0].revents) {
+                char buffer[256];
+                const ssize_t got = read(STDIN_FILENO, buffer, sizeof(buffer));
+                if (got > 0) pending_input.append(buffer, static_cast<size_t>(got));
+                else if (got == 0 || (errno != EINTR && errno != EAGAIN)) input_ended = true;
+            }
+        #endif
+    }
+}
+
+// The key an escape sequence stands for, the ESC has been read already.
+// 0 for sequences nothing here uses.
+int EventLoop::decode_escape() {
+    const int start = next_byte(false, ESCAPE_WAIT_MS);
+    if (start != '[' && start != 'O') {
+        if (start >= 0) pending_input.insert(0, 1, static_cast<char>(start));
+        return KEY_ESCAPE;
+    }
+
+    std::string params;
+    int final = 0;
+    while (final == 0) {
+        const int byte = next_byte(false, ESCAPE_WAIT_MS);
+        if (byte < 0) return KEY_ESCAPE;
+        if (byte >= 0x40 && byte <= 0x7e) final = byte;
+        else if (params.size() < 8) params += static_cast<char>(byte);
+    }
+
+    switch (final) {
+        case 'A': return KEY_UP;
+        case 'B': return KEY_DOWN;
+        case 'H': return KEY_HOME;
+        case 'F': return KEY_END;
+        case '~':
+            if (params == "5") return KEY_PAGE_UP;
+            if (params == "6") return KEY_PAGE_DOWN;
+            if (params == "1" || params == "7") return KEY_HOME;
+            if (params == "4" || params == "8") return KEY_END;
+            return 0;
+        default: return 0;
+    }
+}
+
+int EventLoop::key() {
+    output::flush();
+    while (true) {
+        int key = next_byte(true, -1);
+        if (key == KEY_ESCAPE) key = decode_escape();
+        if (key == '\r') return KEY_ENTER;
+        if (key == '\b') return KEY_BACKSPACE;
+        if (key == CTRL_D && raw) return KEY_EOF;
+        if (key != 0) return key;
+    }
+}
+
+int EventLoop::choice() {
+    const int pressed = key();
+    if (!raw && pressed >= 0 && pressed != KEY_ENTER) skip_line_end = true;
+    return pressed;
+}
+
+bool EventLoop::line(std::string& text) {
+    text.clear();
+    while (true) {
+        output::flush();
+        int key = next_byte(false, -1);
+        if (key == KEY_ESCAPE) key = decode_escape();
+
+        if (key == KEY_EOF || (key == CTRL_D && raw && text.empty())) return !text.empty();
+        if (key == KEY_ESCAPE) {
+            if (raw) output::print('\n');
+            output::flush();
+            return false;
+        }
+        if (key == '\n' || key == '\r') {
+            if (raw) output::print('\n');
+            output::flush();
+            return true;
+        }
+        if (key == KEY_BACKSPACE || key == '\b') {
+            if (text.empty()) continue;
+            size_t start = text.size() - 1;
+            while (start > 0 && (static_cast<unsigned char>(text[start]) & 0xC0) == 0x80) start--;
+            const size_t columns = visible_length(text.c_str() + start, text.size() - start);
+            text.erase(start);
+            if (raw) {
+                for (size_t i = 0; i < columns; i++) output::print("\b \b");
+            }
+            continue;
+        }
+        if (key >= ' ' && key < 256) {
+            text += static_cast<char>(key);
+            if (raw) output::print(static_cast<char>(key));
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// What key() returns: a typed character is its own byte value (0-255),
+// these cover everything else
+#define KEY_EOF (-1)     // input has ended
+#define KEY_REDRAW (-2)  // not a key: something changed, draw the screen again
+#define KEY_RESIZE (-3)  // not a key: the terminal changed size, draw it all again
+#define KEY_ENTER '\n'
+#define KEY_ESCAPE 27
+#define KEY_BACKSPACE 127
+#define KEY_UP 0x101
+#define KEY_DOWN 0x102
+#define KEY_PAGE_UP 0x103
+#define KEY_PAGE_DOWN 0x104
+#define KEY_HOME 0x105
+#define KEY_END 0x106
+
+// The one loop the interactive screens run on. A terminal is put in raw
+// mode so each key arrives as it is pressed, without Enter; while waiting
+// for one, the loop runs due timers, tasks for watched file descriptors
+// and tasks posted from other threads. Input that is not a terminal is
+// read the same way, a byte at a time; there every answer ends its line,
+// which choice() drops, so scripted input works one answer per line.
+class EventLoop {
+public:
+    typedef std::function<void()> Task;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Runs `task` on the loop after `delay_ms`, and every `delay_ms` after
+    // that with `repeat`. Returns an id for cancel(); never 0.
+    unsigned long after(int delay_ms, Task task, bool repeat = false);
+    void cancel(unsigned long timer);
+
+    // Runs `task` on the loop whenever `fd` has something to read
+    void watch(int fd, Task task);
+
+    // Runs `task` on the loop as soon as it is waiting. Safe from any thread.
+    void post(Task task);
+
+    // Makes the screen waiting in key() draw itself again
+    void redraw() { redraw_pending = true; }
+
+    // The next key, running everything above while waiting for it. Keys
+    // already typed come before KEY_REDRAW and KEY_RESIZE.
+    int key();
+    // A single-key answer to a menu or prompt. With input that is not a
+    // terminal, the line end typed after it is dropped too.
+    int choice();
+
+    // A line typed at the cursor and echoed, with backspace. Redraws wait
+    // until it is done. False if cancelled with Escape or input ended.
+    bool line(std::string& text);
+
+private:
+    struct Timer {
+        std::chrono::steady_clock::time_point due;
+        unsigned long id;
+        int period_ms;  // 0: runs once
+        Task task;
+    };
+
+    std::vector<Timer> timers;  // a heap, soonest first
+    unsigned long last_timer;
+    std::vector<std::pair<int, Task>> watched;
+    std::mutex posted_lock;     // guards `posted`
+    std::vector<Task> posted;
+    std::string pending_input;  // read but not yet handed out
+    bool redraw_pending;
+    bool resize_pending;
+    bool raw;
+    bool input_ended;
+    bool skip_line_end;  // after choice(), when not raw
+
+    void run_due();
+    int next_byte(bool allow_redraw, int timeout_ms);
+    int decode_escape();
+};
+
+#endif
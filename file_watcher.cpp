@@ -0,0 +1,101 @@
+#include "file_watcher.h"
+#include <chrono>
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+static std::string directory_of(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? "." : path.substr(0, slash + 1);
+}
+
+static std::string name_of(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+FileWatcher::FileWatcher(const std::vector<std::string>& paths) : halted(false), notify_fd(-1), wake_fds{-1, -1} {
+    for (const std::string& path : paths) {
+        if (!path.empty()) names.push_back(name_of(path));
+    }
+
+    #ifdef __linux__
+        if (paths.empty() || pipe2(wake_fds, O_CLOEXEC | O_NONBLOCK) != 0) return;
+        notify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (notify_fd < 0) return;
+        const uint32_t events = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+        if (inotify_add_watch(notify_fd, directory_of(paths.front()).c_str(), events) < 0) {
+            close(notify_fd);
+            notify_fd = -1;
+        }
+    #endif
+}
+
+FileWatcher::~FileWatcher() {
+    #ifdef __linux__
+        if (notify_fd >= 0) close(notify_fd);
+        if (wake_fds[0] >= 0) close(wake_fds[0]);
+        if (wake_fds[1] >= 0) close(wake_fds[1]);
+    #endif
+}
+
+void FileWatcher::stop() {
+    halted = true;
+    #ifdef __linux__
+        if (wake_fds[1] >= 0) {
+            const char byte = 0;
+            (void)!write(wake_fds[1], &byte, 1);
+        }
+    #endif
+    std::lock_guard<std::mutex> guard(lock);
+    woken.notify_all();
+}
+
+// Reads the queued events; true if any was about one of our files
+bool FileWatcher::drain() {
+    bool relevant = false;
+    #ifdef __linux__
+        alignas(inotify_event) char buffer[4096];
+        while (true) {
+            const ssize_t length = read(notify_fd, buffer, sizeof(buffer));
+            if (length <= 0) break;
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0) {
+                    const std::string name(event->name);
+                    for (const std::string& watched : names) relevant = relevant || name == watched;
+                }
+                if (event->mask & IN_Q_OVERFLOW) relevant = true;
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+    #endif
+    return relevant;
+}
+
+bool FileWatcher::wait(const int timeout_ms) {
+    if (halted) return false;
+
+    #ifdef __linux__
+        if (notify_fd >= 0) {
+            // Events for other files in the directory (lock files, temps)
+            // do not count, so keep waiting out the rest of the timeout
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+            while (true) {
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                if (left.count() < 0) return false;
+                pollfd fds[2] = {{notify_fd, POLLIN, 0}, {wake_fds[0], POLLIN, 0}};
+                if (poll(fds, 2, static_cast<int>(left.count())) <= 0 || halted) return false;
+                if (drain()) return true;
+            }
+        }
+    #endif
+
+    std::unique_lock<std::mutex> guard(lock);
+    woken.wait_for(guard, std::chrono::milliseconds(timeout_ms), [this]() { return halted.load(); });
+    return !halted;
+}
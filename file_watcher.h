@@ -0,0 +1,43 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Reports when any of a few files changes: written to, replaced by a
+// rename, created or deleted. The files' directory is watched with inotify
+// on Linux, so replacements are seen too. Elsewhere every wait just times
+// out and reports a possible change, and callers end up polling.
+class FileWatcher {
+public:
+    explicit FileWatcher(const std::vector<std::string>& paths);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Blocks until one of the files changes, `timeout_ms` passes or stop()
+    // is called. Returns true if a file changed (or may have).
+    bool wait(int timeout_ms);
+
+    // Wakes wait() for good, from any thread
+    void stop();
+    bool stopped() const { return halted; }
+
+private:
+    std::vector<std::string> names;  // file names within the directory
+    std::atomic<bool> halted;
+    int notify_fd;
+    int wake_fds[2];
+
+    // Used where there is no inotify
+    std::mutex lock;
+    std::condition_variable woken;
+
+    bool drain();
+};
+
+#endif
@@ -0,0 +1,82 @@
+// Writes synthetic TODO lists for benchmarking and trying out large lists.
+// Usage: todo-bbs-gen [--priority N] [--regular N] [--words MIN-MAX]
+//                     [--utf8 PERCENT] [--gap N] [--seed N] [--dir DIR]
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "bench_util.h"
+
+namespace {
+
+void usage() {
+    std::cout << "Usage: todo-bbs-gen [--priority N] [--regular N] [--words MIN-MAX]\n"
+              << "                    [--utf8 PERCENT] [--gap N] [--seed N] [--dir DIR]\n"
+              << "Writes priority_todo.txt and regular_todo.txt in DIR (default: .)\n";
+}
+
+// A whole non-negative number, or -1
+long number(const std::string& text) {
+    char* end;
+    const long value = std::strtol(text.c_str(), &end, 10);
+    return text.empty() || *end != '\0' || value < 0 ? -1 : value;
+}
+
+}
+
+int main(const int argc, char** argv) {
+    DatasetSpec spec;
+    std::string dir = ".";
+
+    for (int i = 1; i < argc; i++) {
+        const std::string option = argv[i];
+        if (option == "--help") {
+            usage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            usage();
+            return 2;
+        }
+        const std::string value = argv[++i];
+        const long n = number(value);
+
+        if (option == "--priority" && n >= 0) {
+            spec.priority_items = static_cast<size_t>(n);
+        } else if (option == "--regular" && n >= 0) {
+            spec.regular_items = static_cast<size_t>(n);
+        } else if (option == "--words") {
+            const size_t dash = value.find('-');
+            const long low = number(value.substr(0, dash));
+            const long high = dash == std::string::npos ? low : number(value.substr(dash + 1));
+            if (low < 1 || high < low) {
+                usage();
+                return 2;
+            }
+            spec.min_words = static_cast<int>(low);
+            spec.max_words = static_cast<int>(high);
+        } else if (option == "--utf8" && n >= 0 && n <= 100) {
+            spec.utf8_percent = static_cast<int>(n);
+        } else if (option == "--gap" && n >= 1) {
+            spec.gap = static_cast<int>(n);
+        } else if (option == "--seed" && n >= 0) {
+            spec.seed = static_cast<unsigned>(n);
+        } else if (option == "--dir") {
+            dir = value;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    const std::string priority_path = dir + "/priority_todo.txt";
+    const std::string regular_path = dir + "/regular_todo.txt";
+    if (!write_dataset(spec, priority_path, regular_path)) {
+        std::cout << "  [ERROR] Could not write the lists in " << dir << "\n";
+        return 1;
+    }
+    std::cout << "  [✓] Wrote " << spec.priority_items << " priority items to " << priority_path << "\n"
+              << "  [✓] Wrote " << spec.regular_items << " regular items to " << regular_path << "\n";
+    return 0;
+}
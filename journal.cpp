@@ -0,0 +1,284 @@
+#include "journal.h"
+#include "todo_file.h"
+#include "stats.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+size_t Journal::replay(TodoStore& store) const {
+    std::lock_guard<std::mutex> guard(lock);
+
+    const MappedFile file(file_path);
+    if (!file.is_open()) return 0;
+
+    const char* p = file.data();
+    const char* const end = p + file.size();
+    size_t applied = 0;
+
+    while (p < end) {
+        const char* eol = todofile::find(p, end, '\n');
+        if (eol == end) break;  // torn write from a crash mid-append
+
+        JournalOp op(JournalOp::BUMP, 0, 0, std::string());
+        if (decode(p, eol, op)) {
+            apply(op, store);
+            applied++;
+        }
+        p = eol + 1;
+    }
+
+    return applied;
+}
+
+size_t Journal::read_from(const size_t offset, std::vector<JournalOp>& ops) const {
+    std::lock_guard<std::mutex> guard(lock);
+
+    const MappedFile file(file_path);
+    if (!file.is_open() || file.size() <= offset) return offset;
+
+    const char* const begin = file.data();
+    const char* p = begin + offset;
+    const char* const end = begin + file.size();
+
+    while (p < end) {
+        const char* eol = todofile::find(p, end, '\n');
+        if (eol == end) break;  // still being written
+
+        JournalOp op(JournalOp::BUMP, 0, 0, std::string());
+        if (decode(p, eol, op)) ops.push_back(std::move(op));
+        p = eol + 1;
+    }
+
+    return static_cast<size_t>(p - begin);
+}
+
+void Journal::apply(const JournalOp& op, TodoStore& store) {
+    const char* desc = op.description.data();
+    const size_t length = op.description.size();
+
+    switch (op.kind) {
+        case JournalOp::BUMP:
+            store.bump_from(op.priority);
+            break;
+        case JournalOp::UNBUMP:
+            if (!store.has_priority(op.priority)) store.unbump_from(op.priority);
+            break;
+        case JournalOp::ADD_PRIORITY:
+            store.add_priority(op.priority, op.description);
+            break;
+        case JournalOp::REMOVE_PRIORITY: {
+            const TodoStore::ItemId id = store.find_priority(op.priority, desc, length);
+            if (id != TodoStore::NO_ITEM) store.remove_priority(id, op.priority);
+            break;
+        }
+        case JournalOp::REASSIGN: {
+            const TodoStore::ItemId id = store.find_priority(op.priority, desc, length);
+            if (id != TodoStore::NO_ITEM) store.reassign(id, op.priority, op.target);
+            break;
+        }
+        case JournalOp::ADD_REGULAR:
+            store.add_regular(op.description);
+            break;
+        case JournalOp::INSERT_REGULAR:
+            store.insert_regular(static_cast<size_t>(std::max(op.target, 0)), desc, length);
+            break;
+        case JournalOp::REMOVE_REGULAR: {
+            const std::vector<TodoStore::ItemId>& regular = store.regular_items();
+            const size_t index = static_cast<size_t>(op.target);
+            if (index < regular.size() && store.description_equals(regular[index], desc, length)) {
+                store.remove_regular(index);
+            }
+            break;
+        }
+        case JournalOp::COMPACT:
+            store.compact_priorities();
+            break;
+        case JournalOp::UNCOMPACT: {
+            std::vector<int> priorities;
+            if (decode_priorities(op.description, store.priority_items().size(), priorities)) {
+                store.set_priorities(priorities);
+            }
+            break;
+        }
+        case JournalOp::MOVE_RANGE:
+        case JournalOp::UNMOVE_RANGE: {
+            int before;
+            if (!decode_numbers(op.description, &before, 1)) break;
+            if (op.kind == JournalOp::MOVE_RANGE) store.move_priorities(op.priority, op.target, before);
+            else store.unmove_priorities(op.priority, op.target, before);
+            break;
+        }
+        case JournalOp::INTERLEAVE:
+        case JournalOp::UNINTERLEAVE: {
+            int second[2];
+            if (!decode_numbers(op.description, second, 2)) break;
+            if (op.kind == JournalOp::INTERLEAVE) store.interleave_priorities(op.priority, op.target, second[0], second[1]);
+            else store.uninterleave_priorities(op.priority, op.target, second[0], second[1]);
+            break;
+        }
+    }
+}
+
+void Journal::encode(const JournalOp& op, std::string& out) {
+    out += static_cast<char>(op.kind);
+    out += ' ';
+    out += std::to_string(op.priority);
+    out += ' ';
+    out += std::to_string(op.target);
+    out += ' ';
+    out += op.description;
+    out += '\n';
+}
+
+bool Journal::decode(const char* begin, const char* end, JournalOp& op) {
+    if (end - begin < 2 || begin[1] != ' ') return false;
+
+    switch (begin[0]) {
+        case JournalOp::BUMP: case JournalOp::ADD_PRIORITY: case JournalOp::REMOVE_PRIORITY:
+        case JournalOp::REASSIGN: case JournalOp::ADD_REGULAR: case JournalOp::REMOVE_REGULAR:
+        case JournalOp::UNBUMP: case JournalOp::INSERT_REGULAR: case JournalOp::COMPACT: case JournalOp::UNCOMPACT:
+        case JournalOp::MOVE_RANGE: case JournalOp::UNMOVE_RANGE: case JournalOp::INTERLEAVE:
+        case JournalOp::UNINTERLEAVE:
+            op.kind = static_cast<JournalOp::Kind>(begin[0]);
+            break;
+        default:
+            return false;
+    }
+
+    const char* p = begin + 2;
+    const char* space = todofile::find(p, end, ' ');
+    if (space == end || !todofile::parse_priority(p, space, op.priority)) return false;
+
+    p = space + 1;
+    space = todofile::find(p, end, ' ');
+    if (space == end || !todofile::parse_priority(p, space, op.target)) return false;
+
+    op.description.assign(space + 1, end);
+    return true;
+}
+
+// A run is a stretch whose priorities sit a fixed distance from rank + 1
+void Journal::encode_priorities(const TodoStore& store, std::string& out) {
+    long rank = 0, run_rank = 0, run_start = 0, count = 0;
+    const auto flush = [&]() {
+        if (count == 0) return;
+        if (!out.empty()) out += ' ';
+        out += std::to_string(run_rank) + ':' + std::to_string(run_start) + ':' + std::to_string(count);
+        count = 0;
+    };
+    for (const auto& entry : store.priority_items()) {
+        const long priority = entry.first;
+        if (count > 0 && priority == run_start + count && rank == run_rank + count) {
+            count++;
+        } else {
+            flush();
+            if (priority != rank + 1) {
+                run_rank = rank;
+                run_start = priority;
+                count = 1;
+            }
+        }
+        rank++;
+    }
+    flush();
+}
+
+bool Journal::decode_priorities(const std::string& runs, const size_t items, std::vector<int>& priorities) {
+    const char* p = runs.data();
+    const char* const end = p + runs.size();
+    priorities.resize(items);
+    for (size_t i = 0; i < items; i++) priorities[i] = static_cast<int>(i + 1);
+
+    while (p < end) {
+        const char* space = todofile::find(p, end, ' ');
+        const char* first_colon = todofile::find(p, space, ':');
+        const char* second_colon = first_colon == space ? space : todofile::find(first_colon + 1, space, ':');
+        int rank, start, count;
+        if (second_colon == space || !todofile::parse_priority(p, first_colon, rank)
+            || !todofile::parse_priority(first_colon + 1, second_colon, start)
+            || !todofile::parse_priority(second_colon + 1, space, count)) {
+            return false;
+        }
+        // The counts come from disk: bound them by the list before using them
+        if (rank < 0 || count < 1 || static_cast<size_t>(count) > items
+            || static_cast<size_t>(rank) > items - static_cast<size_t>(count) || start > INT_MAX - (count - 1)) {
+            return false;
+        }
+        for (int i = 0; i < count; i++) priorities[static_cast<size_t>(rank + i)] = start + i;
+        p = space == end ? end : space + 1;
+    }
+    return true;
+}
+
+bool Journal::decode_numbers(const std::string& text, int* numbers, const size_t count) {
+    const char* p = text.data();
+    const char* const end = p + text.size();
+    for (size_t i = 0; i < count; i++) {
+        const char* space = todofile::find(p, end, ' ');
+        if (!todofile::parse_priority(p, space, numbers[i])) return false;
+        p = space == end ? end : space + 1;
+    }
+    return true;
+}
+
+size_t Journal::size() const {
+#ifndef _WIN32
+    struct stat st{};
+    if (stat(file_path.c_str(), &st) != 0) return 0;
+    return static_cast<size_t>(st.st_size);
+#else
+    FILE* f = std::fopen(file_path.c_str(), "rb");
+    if (!f) return 0;
+    std::fseek(f, 0, SEEK_END);
+    const long size = std::ftell(f);
+    std::fclose(f);
+    return size > 0 ? static_cast<size_t>(size) : 0;
+#endif
+}
+
+bool Journal::append(const std::vector<JournalOp>& ops) {
+    if (ops.empty()) return true;
+
+    std::string buffer;
+    for (const auto& op : ops) encode(op, buffer);
+    STATS_RECORD(COMMIT_BYTES, buffer.size());
+
+    std::lock_guard<std::mutex> guard(lock);
+#ifndef _WIN32
+    const int fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+
+    if (!todofile::write_all(fd, buffer.data(), buffer.size())) {
+        close(fd);
+        return false;
+    }
+
+    const bool synced = fdatasync(fd) == 0;
+    return close(fd) == 0 && synced;
+#else
+    FILE* f = std::fopen(file_path.c_str(), "ab");
+    if (!f) return false;
+    const bool written = std::fwrite(buffer.data(), 1, buffer.size(), f) == buffer.size();
+    return std::fclose(f) == 0 && written;
+#endif
+}
+
+bool Journal::fold(const size_t bytes, const std::string& intent, std::vector<std::string> lists) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    std::string tail;
+    {
+        const MappedFile file(file_path);
+        if (file.is_open() && file.size() > bytes) tail.assign(file.data() + bytes, file.size() - bytes);
+    }
+
+    if (!todofile::write_temp(file_path, tail)) return false;
+    lists.push_back(file_path);
+    return todofile::switch_over(intent, lists);
+}
@@ -0,0 +1,86 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include "todo_store.h"
+
+// One recorded edit. Removals and reassignments carry the description so a
+// replay can find the exact item even when priorities are duplicated. The
+// bulk renumberings are one op each, their extra numbers in the description;
+// a compaction keeps the priorities it replaced there, for undo.
+struct JournalOp {
+    enum Kind : char {
+        BUMP = 'B',             // priority: bump everything >= it
+        UNBUMP = 'b',           // priority: undo that bump, it must be free
+        ADD_PRIORITY = 'P',     // priority, description
+        REMOVE_PRIORITY = 'p',  // priority, description
+        REASSIGN = 'M',         // priority -> target, description
+        ADD_REGULAR = 'R',      // description
+        INSERT_REGULAR = 'I',   // target = index, description
+        REMOVE_REGULAR = 'r',   // target = index, description
+        COMPACT = 'C',          // description: the priorities it replaced, as runs
+        UNCOMPACT = 'c',        // description: the priorities to give back, as runs
+        MOVE_RANGE = 'V',       // priority..target, description: the priority to move before
+        UNMOVE_RANGE = 'v',     // the same as the move it undoes
+        INTERLEAVE = 'W',       // priority..target, description: the second range
+        UNINTERLEAVE = 'w'      // the same as the interleave it undoes
+    };
+
+    Kind kind;
+    int priority;
+    int target;
+    std::string description;
+
+    JournalOp(const Kind k, const int pri, const int tgt, std::string desc)
+        : kind(k), priority(pri), target(tgt), description(std::move(desc)) {}
+};
+
+// Append-only log of edits made since the list files were last rewritten.
+// Each op is one text line: "<kind> <priority> <target> <description>".
+// A torn final line (no newline) is ignored on replay.
+class Journal {
+public:
+    explicit Journal(std::string path) : file_path(std::move(path)) {}
+
+    const std::string& path() const { return file_path; }
+
+    // Applies every complete op in the journal to `store`; returns how many
+    size_t replay(TodoStore& store) const;
+
+    // Decodes the complete ops from byte `offset` on, for following what
+    // another process appends. Returns the offset just past the last one.
+    size_t read_from(size_t offset, std::vector<JournalOp>& ops) const;
+
+    // Appends `ops` with a single write and flushes them to disk
+    bool append(const std::vector<JournalOp>& ops);
+
+    // Current size in bytes (0 if the journal does not exist)
+    size_t size() const;
+
+    // Switches `lists` (already written as temps) into place and drops the
+    // first `bytes` bytes of the journal in the same crash-safe step. Ops
+    // appended after those bytes are kept.
+    bool fold(size_t bytes, const std::string& intent, std::vector<std::string> lists);
+
+    static void apply(const JournalOp& op, TodoStore& store);
+    static void encode(const JournalOp& op, std::string& out);
+    static bool decode(const char* begin, const char* end, JournalOp& op);
+
+    // The priorities of `store` that a compaction would change, written as
+    // "rank:first:count" runs (the items from `rank` on, counting from 0,
+    // hold first, first + 1, ...), and read back as all `items` priorities,
+    // rank + 1 wherever no run says otherwise. Runs that do not fit in
+    // `items` are rejected.
+    static void encode_priorities(const TodoStore& store, std::string& out);
+    static bool decode_priorities(const std::string& runs, size_t items, std::vector<int>& priorities);
+    // The `count` blank-separated numbers in `text`
+    static bool decode_numbers(const std::string& text, int* numbers, size_t count);
+
+private:
+    std::string file_path;
+    mutable std::mutex lock;  // append vs background fold
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "list_view.h"
+#include "event_loop.h"
+#include "stats.h"
+
+ListView::ListView(const TodoStore& store, const bool priority, std::string title, const std::string_view body_color,
+                   const std::string_view bar_color)
+    : store(store), priority(priority), title(std::move(title)), body_color(body_color),
+      bar_color(bar_color), first(0), height(1), box_width(0),
+      drawn_revision(0), drawn_first(0), drawn_height(0), drawn_numbered(false) {}
+
+size_t ListView::size() const {
+    return priority ? store.priority_items().size() : store.regular_items().size();
+}
+
+void ListView::scroll(const long rows) {
+    if (rows < 0 && static_cast<size_t>(-rows) > first) first = 0;
+    else first += rows;
+}
+
+void ListView::jump(const int target) {
+    if (priority) first = store.priority_items().rank(target);
+    else first = target > 1 ? static_cast<size_t>(target - 1) : 0;
+}
+
+bool ListView::key(const int key) {
+    switch (key) {
+        case 'n': case KEY_PAGE_DOWN: page(1); break;
+        case 'p': case KEY_PAGE_UP: page(-1); break;
+        case 'j': case KEY_DOWN: scroll(1); break;
+        case 'k': case KEY_UP: scroll(-1); break;
+        case 't': case KEY_HOME: first = 0; break;
+        case 'b': case KEY_END: first = size(); break;
+        default: return false;
+    }
+    return true;
+}
+
+u_long ListView::width_of(const TodoStore::ItemId id, const unsigned long revision) {
+    if (id >= widths.size()) widths.resize(id + 1, std::make_pair(0ul, 0ul));
+    std::pair<unsigned long, u_long>& cached = widths[id];
+    if (cached.first != revision) {
+        cached.first = revision;
+        cached.second = visible_length(store.description_data(id), store.description_size(id));
+    }
+    return cached.second;
+}
+
+const std::string& ListView::render(const unsigned long revision, const bool numbered) {
+    const size_t total = size();
+    if (first + height > total) first = total > height ? total - height : 0;
+
+    if (!box.empty() && revision == drawn_revision && numbered == drawn_numbered
+        && first == drawn_first && height == drawn_height) {
+        return box;
+    }
+    STATS_TIMER(RENDER_US);
+
+    // The list changed, so the widest row may be gone
+    if (revision != drawn_revision || numbered != drawn_numbered) box_width = 0;
+    drawn_revision = revision;
+    drawn_numbered = numbered;
+    drawn_first = first;
+    drawn_height = height;
+
+    const size_t last = first + height < total ? first + height : total;
+    lines.clear();
+    line_widths.clear();
+
+    if (total == 0) {
+        lines.emplace_back("(empty)");
+        line_widths.push_back(7);
+    } else if (priority) {
+        // One O(log n) seek to the window, then a walk along it
+        PriorityIndex<TodoStore::ItemId>::const_iterator it = store.priority_items().at(first);
+        for (size_t i = first; i < last; i++, ++it) {
+            const std::string tag = "[" + std::to_string((*it).first) + "] ";
+            lines.push_back(tag + store.description((*it).second));
+            line_widths.push_back(tag.size() + width_of((*it).second, revision));
+        }
+    } else {
+        for (size_t i = first; i < last; i++) {
+            const TodoStore::ItemId id = store.regular_items()[i];
+            if (numbered) {
+                const std::string tag = "[" + std::to_string(i + 1) + "] ";
+                lines.push_back(tag + store.description(id));
+                line_widths.push_back(tag.size() + width_of(id, revision));
+            } else {
+                lines.push_back("• " + store.description(id));
+                line_widths.push_back(2 + width_of(id, revision));
+            }
+        }
+    }
+
+    // Say where the window is when the list does not fit in it
+    std::string heading = title;
+    if (total > height) {
+        heading += " " + std::to_string(first + 1) + "-" + std::to_string(last) + "/" + std::to_string(total);
+    }
+
+    box.clear();
+    box_width = boxes::render(box, heading, lines, line_widths, box_width, body_color, bar_color, "  ");
+    return box;
+}
@@ -0,0 +1,75 @@
+#ifndef LIST_VIEW_H
+#define LIST_VIEW_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "boxes.h"
+#include "todo_store.h"
+
+// A scrolling window onto one of the store's lists. Only the rows inside
+// the window are formatted and measured, so drawing it costs O(rows shown)
+// however long the list is. Description widths are cached per item, and
+// the box keeps the widest width it has needed until the list changes, so
+// it does not jitter while scrolling.
+class ListView {
+public:
+    // The colors are kept as views, so they must outlive the view: literals
+    // or theme constants (see theme.h)
+    ListView(const TodoStore& store, bool priority, std::string title, std::string_view body_color,
+             std::string_view bar_color);
+
+    size_t size() const;
+    size_t top() const { return first; }
+
+    // Number of items shown at once
+    void resize(size_t rows) { height = rows > 0 ? rows : 1; }
+
+    void scroll(long rows);
+    void page(long pages) { scroll(pages * static_cast<long>(height)); }
+
+    // Puts the first item with priority >= `target` at the top; for the
+    // regular list, item number `target`
+    void jump(int target);
+
+    // Applies one scroll key (see event_loop.h):
+    //   n / p   PgDn / PgUp   next / previous page
+    //   j / k   Down / Up     down / up one row
+    //   t / b   Home / End    top / bottom
+    // Returns false if `key` is none of these.
+    bool key(int key);
+
+    // The window drawn as a box; `numbered` labels regular items [1], [2]...
+    // instead of bullets. Reused as is while nothing it shows has changed.
+    const std::string& render(unsigned long revision, bool numbered = false);
+
+private:
+    const TodoStore& store;
+    bool priority;
+    std::string title;
+    std::string_view body_color;
+    std::string_view bar_color;
+
+    size_t first;
+    size_t height;
+
+    // Description width per item id, tagged with the revision it was measured at
+    std::vector<std::pair<unsigned long, u_long>> widths;
+    u_long box_width;
+
+    // What the cached box was drawn from
+    std::string box;
+    unsigned long drawn_revision;
+    size_t drawn_first;
+    size_t drawn_height;
+    bool drawn_numbered;
+
+    // Scratch rows, kept to reuse their capacity
+    std::vector<std::string> lines;
+    std::vector<u_long> line_widths;
+
+    u_long width_of(TodoStore::ItemId id, unsigned long revision);
+};
+
+#endif
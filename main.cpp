@@ -5,503 +5,846 @@
 #include <string>
 #include <algorithm>
 #include <limits>
+#include <cerrno>
+#include <cstdio>
 #include <cstdlib>
-#include <thread>
+#include <memory>
 
 #include "colors.h"
 #include "boxes.h"
+#include "todo_session.h"
+#include "todo_file.h"
+#include "screen.h"
+#include "list_view.h"
+#include "event_loop.h"
+#include "batch.h"
+#include "stats.h"
+#include "workspace.h"
+#include "theme.h"
+#include "output.h"
 #define VERSION "v1.2.0"
 
-struct TodoItem {
-    std::string description;
-    int priority;  // -1 for non-priority items
-    bool is_priority;
+// Rows each screen spends on everything but its list windows
+#define MAIN_CHROME 21    // header, two box frames, menu
+#define VIEW_CHROME 11    // header, box frame, key help, prompt
+#define REMOVE_CHROME 13  // header, title, box frame, key help, prompt
+#define COMMIT_CHROME 15  // header, title, two box frames, prompt
+#define SEARCH_CHROME 16  // header, title, help, box frame, notes, prompt
+#define LISTS_CHROME 11   // header, title, box frame, key help, prompt
 
-    explicit TodoItem(std::string  desc, const bool is_pri = false, const int pri = -1)
-        : description(std::move(desc)), priority(pri), is_priority(is_pri) {}
-};
+// How long the outcome of an action stays under the header
+#define NOTICE_MS 4000
+
+#define SCROLL_KEYS "  [n/p] page  [j/k] scroll  [t/b] top/bottom"
 
+// The menus, drawn in the colors of `Theme` (see theme.h)
+template <class Theme>
 class TodoBBS {
 private:
-    std::vector<TodoItem> priority_list;
-    std::vector<TodoItem> regular_list;
-    std::string priority_file;
-    std::string regular_file;
-    bool has_changes;
-
-    static void clear_screen() {
-        #ifdef _WIN32
-            system("cls");
-        #else
-            system("clear");
-        #endif
-    }
-
-    void draw_header() const {
-        std::cout << boxes::box("", {"░▒▓ TODO-BBS " + std::string(VERSION) + " ▓▒░", "A Retro styled Todo Manager"}, CYAN BOLD, CYAN BOLD);
-
-        // Show modification status
-        if (has_changes) {
-            std::cout << YELLOW << "  [*] UNCOMMITTED CHANGES" << RESET << "\n";
-        } else {
-            std::cout << GREEN << "  [✓] All changes committed" << RESET << "\n";
+    EventLoop& loop;
+    Workspace& workspace;
+    const std::string list_name;
+    TodoSession& session;
+    const TodoStore& store;
+
+    Screen screen;
+
+    // Rendered once and reused until what they show changes
+    mutable std::string header_box;
+    mutable std::string header_status;
+    ListView priority_view;
+    ListView regular_view;
+
+    // The result of the last action, shown under the header for a while
+    std::string notice;
+    unsigned long notice_timer;
+
+    // Autosave interval (0: off), and the timer for the next one
+    int autosave_ms;
+    unsigned long autosave_timer;
+    bool autosave_due;
+
+    // Modification status, including how pending edits fared against
+    // changes other processes committed meanwhile
+    std::string status() const {
+        if (session.conflicts() > 0) {
+            return RED "  [!] UNCOMMITTED CHANGES - " + std::to_string(session.conflicts())
+                   + " clashed with changes made elsewhere and were dropped" RESET "\n";
         }
-        std::cout << "\n";
+        if (session.diverged()) return YELLOW "  [*] UNCOMMITTED CHANGES (merged with changes made elsewhere)" RESET "\n";
+        if (session.has_changes() && autosave_ms > 0) return YELLOW "  [*] UNSAVED CHANGES (autosave on)" RESET "\n";
+        if (session.has_changes()) return YELLOW "  [*] UNCOMMITTED CHANGES" RESET "\n";
+        return GREEN "  [✓] All changes committed" RESET "\n";
     }
 
-    static void draw_separator(const std::string& c = "-") {
-        std::cout << BLUE;
-        for (int i = 0; i < 72; i++) std::cout << c;
-        std::cout << RESET << "\n";
+    const std::string& header() const {
+        const std::string current = status();
+        if (header_box.empty() || header_status != current) {
+            header_status = current;
+            header_box = boxes::box("", {"░▒▓ TODO-BBS " + std::string(VERSION) + " ▓▒░", "A Retro styled Todo Manager"}, Theme::banner, Theme::banner);
+            header_box += header_status;
+        }
+        return header_box;
     }
 
-    static void load_from_file(const std::string& filename, std::vector<TodoItem>& list, bool is_priority) {
-        std::ifstream file(filename);
-        if (!file.is_open()) return;
-
-        std::string line;
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
-
-            if (is_priority) {
-                size_t pos = line.find('|');
-                if (pos != std::string::npos) {
-                    int pri = std::stoi(line.substr(0, pos));
-                    std::string desc = line.substr(pos + 1);
-                    list.emplace_back(desc, true, pri);
-                }
-            } else {
-                list.emplace_back(line, false);
-            }
-        }
-        file.close();
+    // The header, with the notice in the line under it that is otherwise blank
+    std::string top() const {
+        std::string text = header();
+        text += notice;
+        text += "\n";
+        return text;
     }
 
-    static void save_to_file(const std::string& filename, const std::vector<TodoItem>& list, const bool is_priority) {
-        std::ofstream file(filename);
-        if (!file.is_open()) {
-            std::cout << RED << "  [ERROR] Could not save to file: " << filename << RESET << "\n";
-            return;
+    // Takes in what other processes committed, and autosaves. Only called
+    // just before a screen is drawn, never while an action holds on to item
+    // ids, since a save that has to merge reloads the lists.
+    void refresh() {
+        // Whatever the last action edited is one step to undo
+        session.end_step();
+        session.sync();
+        if (autosave_due) {
+            autosave_due = false;
+            if (!session.save()) tell(RED "  [ERROR] Autosave failed; will try again" RESET);
         }
 
-        for (const auto& item : list) {
-            if (is_priority) {
-                file << item.priority << "|" << item.description << "\n";
-            } else {
-                file << item.description << "\n";
-            }
+        // Edits made within one interval go out together when it is up
+        if (autosave_ms > 0 && autosave_timer == 0 && session.has_changes() && !session.saving()) {
+            autosave_timer = loop.after(autosave_ms, [this]() {
+                autosave_timer = 0;
+                autosave_due = true;
+                loop.redraw();
+            });
         }
-        file.close();
     }
 
-    void display_priority_list() const
-    {
-        // Sort by priority
-        std::vector<TodoItem> sorted = priority_list;
-        std::sort(sorted.begin(), sorted.end(),
-            [](const TodoItem& a, const TodoItem& b) { return a.priority < b.priority; });
+    // What the list windows of list `name` add to their titles
+    static std::string list_title(const std::string& name) {
+        return name.empty() ? "" : " - " + name;
+    }
 
-        std::vector<std::string> toDisp;
+    // Shares what `chrome` leaves of the terminal between both list
+    // windows, giving the priority list whatever the regular one won't use
+    void fit_lists(const size_t chrome) {
+        const size_t room = Screen::room(chrome);
+        const size_t regular_rows = std::max<size_t>(std::min(regular_view.size(), room / 2), 1);
+        priority_view.resize(room > regular_rows ? room - regular_rows : 1);
+        regular_view.resize(regular_rows);
+    }
 
-        if (sorted.empty()) {
-            toDisp.emplace_back("(empty)");
-        } else {
-            for (const auto& item : sorted) {
-                toDisp.push_back("[" + std::to_string(item.priority) + "] " + item.description);
-            }
+    // A key answering a prompt below the current frame. Redraws wait until
+    // the action is over.
+    int answer() {
+        while (true) {
+            const int key = loop.choice();
+            if (key == KEY_RESIZE) screen.invalidate();
+            else if (key != KEY_REDRAW) return key;
         }
-
-        std::cout << boxes::indent(boxes::box("PRIORITY TODO LIST", toDisp, CYAN, MAGENTA BOLD), "  ");
     }
 
-    void display_regular_list() const
-    {
-        std::vector<std::string> toDisp;
+    bool confirm(const std::string& question) {
+        output::print(RED, question, " (y/n): " RESET);
+        const int key = answer();
+        const bool yes = key == 'y' || key == 'Y';
+        output::print(yes ? "y\n" : "n\n");
+        return yes;
+    }
 
-        if (regular_list.empty()) {
-            toDisp.emplace_back("(empty)");
-        } else {
-            for (const auto& item : regular_list) {
-                toDisp.push_back("• " + item.description);
-            }
+    // A number typed at `prompt`; false if cancelled or not a number
+    bool ask_number(const std::string& prompt, int& number) {
+        output::print(prompt);
+        std::string text;
+        if (!loop.line(text)) return false;
+
+        char* end;
+        errno = 0;
+        const long value = std::strtol(text.c_str(), &end, 10);
+        while (*end == ' ') end++;
+        if (end == text.c_str() || *end != '\0' || errno == ERANGE
+            || value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+            return false;
         }
-
-        std::cout << boxes::indent(boxes::box("REGULAR TODO LIST", toDisp, CYAN, GREEN BOLD), "  ");
+        number = static_cast<int>(value);
+        return true;
     }
 
-    int find_priority_index(const int priority) const
-    {
-        for (int i = 0; i < priority_list.size(); i++) {
-            if (priority_list[i].priority == priority) {
-                return i;
+    // Shows `view` until a number is typed and confirmed with ENTER (true,
+    // in `number`) or the user backs out with ESC, q or a bare ENTER. The
+    // scroll keys work throughout.
+    bool browse(ListView& view, const std::string& title, const std::string& prompt, const size_t chrome,
+                const bool numbered, int& number) {
+        std::string typed;
+        while (true) {
+            refresh();
+            view.resize(Screen::room(chrome));
+            std::string frame = top();
+            frame += title;
+            frame += view.render(session.revision(), numbered);
+            frame += "\n" CYAN SCROLL_KEYS "  [ESC] back" RESET "\n";
+            frame += YELLOW + prompt + RESET + typed;
+            screen.present(frame);
+
+            const int key = loop.key();
+            if (key == KEY_RESIZE) {
+                screen.invalidate();
+            } else if ((key >= '0' && key <= '9') || (key == '-' && typed.empty())) {
+                if (typed.size() < 9) typed += static_cast<char>(key);
+            } else if (key == KEY_BACKSPACE) {
+                if (!typed.empty()) typed.pop_back();
+            } else if (key == KEY_ENTER && !typed.empty() && typed != "-") {
+                number = std::atoi(typed.c_str());
+                return true;
+            } else if (key == KEY_ENTER || key == KEY_ESCAPE || key == KEY_EOF || key == 'q') {
+                return false;
+            } else {
+                view.key(key);
             }
         }
-        return -1;
     }
 
-    void bump_priorities_down(const int starting_priority) {
-        for (auto& item : priority_list) {
-            if (item.priority >= starting_priority) {
-                item.priority++;
-            }
-        }
+public:
+    // Shows `text` under the header for a few seconds. Actions report their
+    // outcome this way rather than waiting for a key to be pressed.
+    void tell(const std::string& text) {
+        notice = text;
+        loop.cancel(notice_timer);
+        notice_timer = loop.after(NOTICE_MS, [this]() {
+            notice.clear();
+            notice_timer = 0;
+            loop.redraw();
+        });
     }
 
+    // Commits edits in the background at most every `interval_ms`, and on exit
+    void autosave(const int interval_ms) {
+        autosave_ms = interval_ms > 0 ? interval_ms : 0;
+    }
+
+private:
     void handle_priority_conflict(const std::string& new_desc, int new_priority) {
-        std::cout << RED << "\n  [!] Priority " << new_priority << " already exists!" << RESET << "\n";
-        std::cout << "      Current item: " << CYAN
-                  << priority_list[find_priority_index(new_priority)].description
-                  << RESET << "\n\n";
-
-        std::cout << "  [1] Bump - Auto-reassign all conflicting priorities down\n";
-        std::cout << "  [2] Reassign - Manually reassign priorities\n";
-        std::cout << "  [3] Cancel\n\n";
-        std::cout << YELLOW << "  > Select option: " << RESET;
-
-        int choice;
-        std::cin >> choice;
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-        if (choice == 1) {
-            bump_priorities_down(new_priority);
-            priority_list.emplace_back(new_desc, true, new_priority);
-            has_changes = true;
-            std::cout << GREEN << "\n  [✓] Item added, priorities bumped down" << RESET << "\n";
-        } else if (choice == 2) {
+        output::print(RED "\n  [!] Priority ", new_priority, " already exists!" RESET "\n");
+        output::print("      Current item: " CYAN, store.description(store.find_priority(new_priority)), RESET "\n\n");
+
+        output::print("  [1] Bump - Auto-reassign all conflicting priorities down\n");
+        output::print("  [2] Reassign - Manually reassign priorities\n");
+        output::print("  [3] Cancel\n\n");
+        output::print(YELLOW "  > Select option: " RESET);
+
+        const int choice = answer();
+        if (choice == '1') {
+            session.bump_from(new_priority);
+            session.add_priority(new_priority, new_desc);
+            tell(GREEN "  [✓] Item added, priorities bumped down" RESET);
+        } else if (choice == '2') {
             manual_reassign(new_desc, new_priority);
         } else {
-            std::cout << RED << "\n  [✗] Addition cancelled" << RESET << "\n";
+            tell(RED "  [✗] Addition cancelled" RESET);
         }
     }
 
     void manual_reassign(const std::string& new_desc, int new_priority) {
-        std::cout << "\n" << YELLOW << "  ═══ MANUAL PRIORITY REASSIGNMENT ═══" << RESET << "\n\n";
+        output::print("\n\n" YELLOW "  ═══ MANUAL PRIORITY REASSIGNMENT ═══" RESET "\n\n");
+
+        // Show all conflicting items. Only this tail of the list is copied,
+        // since reassigning below rearranges the index.
+        const PriorityIndex<TodoStore::ItemId>& index = store.priority_items();
+        std::vector<std::pair<int, TodoStore::ItemId>> conflicting;
+        for (auto it = index.lower_bound(new_priority); it != index.end(); ++it) {
+            conflicting.emplace_back((*it).first, (*it).second);
+        }
 
-        // Show all conflicting items
-        std::vector<TodoItem*> conflicting;
-        for (auto& item : priority_list) {
-            if (item.priority >= new_priority) {
-                conflicting.push_back(&item);
-            }
+        output::print("  Items that need reassignment:\n\n");
+        for (const auto& item : conflicting) {
+            output::print("  [", item.first, "] ", store.description(item.second), "\n");
         }
 
-        std::sort(conflicting.begin(), conflicting.end(),
-            [](const TodoItem* a, const TodoItem* b) { return a->priority < b->priority; });
+        output::print("\n  New item:\n");
+        output::print("  [", new_priority, "] ", new_desc, "\n\n");
 
-        std::cout << "  Items that need reassignment:\n\n";
-        for (const auto* item : conflicting) {
-            std::cout << "  [" << item->priority << "] " << item->description << "\n";
-        }
+        // Reassign each; ESC keeps an item where it is
+        for (const auto& item : conflicting) {
+            output::print(CYAN "  Reassign [", item.first, "] ", store.description(item.second), RESET "\n");
+            while (true) {
+                int new_pri;
+                if (!ask_number("  New priority: ", new_pri) || new_pri == item.first) break;
 
-        std::cout << "\n  New item:\n";
-        std::cout << "  [" << new_priority << "] " << new_desc << "\n\n";
-
-        // Reassign each
-        for (auto* item : conflicting) {
-            std::cout << CYAN << "  Reassign [" << item->priority << "] "
-                     << item->description << RESET << "\n";
-            std::cout << "  New priority: ";
-            int new_pri;
-            std::cin >> new_pri;
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-            if (new_pri == item->priority) continue;
-
-            // Check if new priority conflicts
-            if (find_priority_index(new_pri) != -1) {
-                std::cout << RED << "  [!] Priority " << new_pri
-                         << " already assigned. Try again." << RESET << "\n";
-                // Re-do this item
-                continue;
-            }
+                if (store.has_priority(new_pri)) {
+                    output::print(RED "  [!] Priority ", new_pri, " already assigned. Try again." RESET "\n");
+                    continue;
+                }
 
-            item->priority = new_pri;
+                session.reassign(item.second, item.first, new_pri);
+                break;
+            }
         }
 
-        priority_list.emplace_back(new_desc, true, new_priority);
-        has_changes = true;
-        std::cout << GREEN << "\n  [✓] Items reassigned successfully" << RESET << "\n";
+        session.add_priority(new_priority, new_desc);
+        tell(GREEN "  [✓] Items reassigned successfully" RESET);
     }
 
     void add_item() {
-        clear_screen();
-        draw_header();
-        std::cout << YELLOW << "  ═══ ADD TODO ITEM ═══" << RESET << "\n\n";
-
-        std::cout << "  [1] Priority Item\n";
-        std::cout << "  [2] Regular Item\n\n";
-        std::cout << CYAN << "  > Select type: " << RESET;
+        std::string frame = top();
+        frame += YELLOW "  ═══ ADD TODO ITEM ═══" RESET "\n\n";
 
-        int type;
-        std::cin >> type;
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        frame += "  [1] Priority Item\n";
+        frame += "  [2] Regular Item\n\n";
+        frame += CYAN "  > Select type: " RESET;
+        screen.present(frame);
 
-        if (type == 1) {
-            std::cout << YELLOW << "\n  Enter priority number: " << RESET;
+        const int type = answer();
+        if (type == '1') {
             int priority;
-            std::cin >> priority;
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            if (!ask_number(YELLOW "\n  Enter priority number: " RESET, priority)) {
+                tell(RED "  [✗] Addition cancelled" RESET);
+                return;
+            }
 
-            std::cout << YELLOW << "  Enter description: " << RESET;
+            output::print(YELLOW "  Enter description: " RESET);
             std::string desc;
-            std::getline(std::cin, desc);
-
-            if (desc.empty()) {
-                std::cout << RED << "\n  [✗] Description cannot be empty" << RESET << "\n";
-                pause();
+            if (!loop.line(desc) || desc.empty()) {
+                tell(RED "  [✗] Description cannot be empty" RESET);
                 return;
             }
 
             // Check for priority conflicts
-            if (find_priority_index(priority) != -1) {
+            if (store.has_priority(priority)) {
                 handle_priority_conflict(desc, priority);
             } else {
-                priority_list.emplace_back(desc, true, priority);
-                has_changes = true;
-                std::cout << GREEN << "\n  [✓] Priority item added" << RESET << "\n";
+                session.add_priority(priority, desc);
+                tell(GREEN "  [✓] Priority item added" RESET);
             }
 
-        } else if (type == 2) {
-            std::cout << YELLOW << "\n  Enter description: " << RESET;
+        } else if (type == '2') {
+            output::print(YELLOW "\n  Enter description: " RESET);
             std::string desc;
-            std::getline(std::cin, desc);
-
-            if (desc.empty()) {
-                std::cout << RED << "\n  [✗] Description cannot be empty" << RESET << "\n";
-                pause();
+            if (!loop.line(desc) || desc.empty()) {
+                tell(RED "  [✗] Description cannot be empty" RESET);
                 return;
             }
 
-            regular_list.emplace_back(desc, false);
-            has_changes = true;
-            std::cout << GREEN << "\n  [✓] Regular item added" << RESET << "\n";
+            session.add_regular(desc);
+            tell(GREEN "  [✓] Regular item added" RESET);
         }
-
-        pause();
     }
 
     void remove_item() {
-        clear_screen();
-        draw_header();
-        std::cout << YELLOW << "  ═══ REMOVE TODO ITEM ═══" << RESET << "\n\n";
-
-        std::cout << "  [1] Priority List\n";
-        std::cout << "  [2] Regular List\n\n";
-        std::cout << CYAN << "  > Select list: " << RESET;
-
-        int list_choice;
-        std::cin >> list_choice;
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-        if (list_choice == 1) {
-            if (priority_list.empty()) {
-                std::cout << RED << "\n  [✗] Priority list is empty" << RESET << "\n";
-                pause();
+        std::string frame = top();
+        frame += YELLOW "  ═══ REMOVE TODO ITEM ═══" RESET "\n\n";
+
+        frame += "  [1] Priority List\n";
+        frame += "  [2] Regular List\n\n";
+        frame += CYAN "  > Select list: " RESET;
+        screen.present(frame);
+
+        const int list_choice = answer();
+        if (list_choice == '1') {
+            if (store.priority_items().empty()) {
+                tell(RED "  [✗] Priority list is empty" RESET);
                 return;
             }
 
-            clear_screen();
-            draw_header();
-            std::cout << YELLOW << "  ═══ PRIORITY LIST ═══" << RESET << "\n\n";
-
-            std::vector<TodoItem> sorted = priority_list;
-            std::sort(sorted.begin(), sorted.end(),
-                [](const TodoItem& a, const TodoItem& b) { return a.priority < b.priority; });
-
-            for (const auto& item : sorted) {
-                std::cout << "  [" << item.priority << "] " << item.description << "\n";
-            }
-
-            std::cout << YELLOW << "\n  > Enter priority to remove (0 to cancel): " << RESET;
             int priority;
-            std::cin >> priority;
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-            const int idx = find_priority_index(priority);
-            if (idx == -1) {
-                std::cout << RED << "\n  [✗] Priority not found" << RESET << "\n";
-                pause();
+            if (!browse(priority_view, YELLOW "  ═══ PRIORITY LIST ═══" RESET "\n\n",
+                        "  > Enter priority to remove: ", REMOVE_CHROME, false, priority)) {
                 return;
             }
 
-            std::cout << RED << "\n  Remove: " << priority_list[idx].description
-                     << "? (y/n): " << RESET;
-            char confirm;
-            std::cin >> confirm;
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            const TodoStore::ItemId found = store.find_priority(priority);
+            if (found == TodoStore::NO_ITEM) {
+                tell(RED "  [✗] Priority not found" RESET);
+                return;
+            }
 
-            if (confirm == 'y' || confirm == 'Y') {
-                priority_list.erase(priority_list.begin() + idx);
-                has_changes = true;
-                std::cout << GREEN << "\n  [✓] Item removed" << RESET << "\n";
+            if (confirm("\n  Remove: " + store.description(found) + "?")) {
+                session.remove_priority(found, priority);
+                tell(GREEN "  [✓] Item removed" RESET);
             } else {
-                std::cout << RED << "\n  [✗] Removal cancelled" << RESET << "\n";
+                tell(RED "  [✗] Removal cancelled" RESET);
             }
 
-        } else if (list_choice == 2) {
+        } else if (list_choice == '2') {
+            const std::vector<TodoStore::ItemId>& regular_list = store.regular_items();
             if (regular_list.empty()) {
-                std::cout << RED << "\n  [✗] Regular list is empty" << RESET << "\n";
-                pause();
+                tell(RED "  [✗] Regular list is empty" RESET);
                 return;
             }
 
-            clear_screen();
-            draw_header();
-            std::cout << YELLOW << "  ═══ REGULAR LIST ═══" << RESET << "\n\n";
-
-            for (size_t i = 0; i < regular_list.size(); i++) {
-                std::cout << "  [" << (i + 1) << "] " << regular_list[i].description << "\n";
-            }
-
-            std::cout << YELLOW << "\n  > Select item to remove (0 to cancel): " << RESET;
             int choice;
-            std::cin >> choice;
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            if (!browse(regular_view, YELLOW "  ═══ REGULAR LIST ═══" RESET "\n\n",
+                        "  > Select item to remove: ", REMOVE_CHROME, true, choice)) {
+                return;
+            }
 
             if (choice < 1 || choice > static_cast<int>(regular_list.size())) {
-                std::cout << RED << "\n  [✗] Removal cancelled" << RESET << "\n";
-                pause();
+                tell(RED "  [✗] No such item" RESET);
                 return;
             }
 
-            std::cout << RED << "\n  Remove: " << regular_list[choice - 1].description
-                     << "? (y/n): " << RESET;
-            char confirm;
-            std::cin >> confirm;
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-            if (confirm == 'y' || confirm == 'Y') {
-                regular_list.erase(regular_list.begin() + (choice - 1));
-                has_changes = true;
-                std::cout << GREEN << "\n  [✓] Item removed" << RESET << "\n";
+            if (confirm("\n  Remove: " + store.description(regular_list[choice - 1]) + "?")) {
+                session.remove_regular(static_cast<size_t>(choice - 1));
+                tell(GREEN "  [✓] Item removed" RESET);
             } else {
-                std::cout << RED << "\n  [✗] Removal cancelled" << RESET << "\n";
+                tell(RED "  [✗] Removal cancelled" RESET);
             }
         }
-
-        pause();
     }
 
     void commit_changes() {
-        if (!has_changes) {
-            std::cout << CYAN << "\n  [i] No changes to commit" << RESET << "\n";
-            pause();
+        if (!session.has_changes()) {
+            tell(CYAN "  [i] No changes to commit" RESET);
             return;
         }
 
-        clear_screen();
-        draw_header();
-        std::cout << YELLOW << "  ═══ COMMIT CHANGES ═══" << RESET << "\n\n";
+        std::string frame = top();
+        frame += YELLOW "  ═══ COMMIT CHANGES ═══" RESET "\n\n";
+
+        frame += "  The following changes will be saved:\n\n";
+        fit_lists(COMMIT_CHROME);
+        frame += priority_view.render(session.revision());
+        frame += regular_view.render(session.revision());
+
+        frame += RED "  Confirm commit? (y/n): " RESET;
+        screen.present(frame);
+
+        const int confirm = answer();
+        if (confirm != 'y' && confirm != 'Y') {
+            tell(RED "  [✗] Commit cancelled" RESET);
+        } else if (!session.commit()) {
+            tell(RED "  [ERROR] Could not write the journal next to: " + session.priority_path() + RESET);
+        } else if (session.merged()) {
+            std::string text = GREEN "  [✓] Changes committed, merged with changes made elsewhere";
+            if (session.dropped()) text += " (" + std::to_string(session.dropped()) + " skipped, their items are gone)";
+            tell(text + RESET);
+        } else {
+            tell(GREEN "  [✓] Changes committed successfully!" RESET);
+        }
+    }
 
-        std::cout << "  The following changes will be saved:\n\n";
-        display_priority_list();
-        display_regular_list();
+    // Bulk renumbering of the priority list; each is one edit to undo
+    void reorder_items() {
+        if (store.priority_items().empty()) {
+            tell(RED "  [✗] Priority list is empty" RESET);
+            return;
+        }
 
-        std::cout << RED << "  Confirm commit? (y/n): " << RESET;
-        char confirm;
-        std::cin >> confirm;
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::string frame = top();
+        frame += YELLOW "  ═══ REORDER PRIORITIES ═══" RESET "\n\n";
+
+        frame += "  [1] Renumber 1, 2, 3... keeping the order\n";
+        frame += "  [2] Move a range of priorities\n";
+        frame += "  [3] Interleave two ranges\n\n";
+        frame += CYAN "  > Select action: " RESET;
+        screen.present(frame);
+
+        const int action = answer();
+        if (action == '1') {
+            if (session.compact_priorities()) tell(GREEN "  [✓] Priorities renumbered" RESET);
+            else tell(CYAN "  [i] Priorities are already numbered 1, 2, 3..." RESET);
+        } else if (action == '2') {
+            int first, last, before;
+            if (!ask_number(YELLOW "\n  First priority of the range: " RESET, first)
+                || !ask_number(YELLOW "  Last priority of the range: " RESET, last)
+                || !ask_number(YELLOW "  Move in front of priority: " RESET, before)) {
+                tell(RED "  [✗] Move cancelled" RESET);
+            } else if (first > last) {
+                tell(RED "  [✗] The range is backwards" RESET);
+            } else if (session.move_priorities(first, last, before)) {
+                tell(GREEN "  [✓] Range moved" RESET);
+            } else {
+                tell(CYAN "  [i] Nothing to move" RESET);
+            }
+        } else if (action == '3') {
+            int first, last, second_first, second_last;
+            if (!ask_number(YELLOW "\n  First range, from priority: " RESET, first)
+                || !ask_number(YELLOW "  First range, to priority: " RESET, last)
+                || !ask_number(YELLOW "  Second range, from priority: " RESET, second_first)
+                || !ask_number(YELLOW "  Second range, to priority: " RESET, second_last)) {
+                tell(RED "  [✗] Interleave cancelled" RESET);
+            } else if (first > last || last >= second_first || second_first > second_last) {
+                tell(RED "  [✗] The ranges must be in order and not overlap" RESET);
+            } else if (session.interleave_priorities(first, last, second_first, second_last)) {
+                tell(GREEN "  [✓] Ranges interleaved" RESET);
+            } else {
+                tell(CYAN "  [i] One of the ranges is empty" RESET);
+            }
+        }
+    }
 
-        if (confirm == 'y' || confirm == 'Y') {
-            save_to_file(priority_file, priority_list, true);
-            save_to_file(regular_file, regular_list, false);
-            has_changes = false;
-            std::cout << GREEN << "\n  [✓] Changes committed successfully!" << RESET << "\n";
-        } else {
-            std::cout << RED << "\n  [✗] Commit cancelled" << RESET << "\n";
+    // Frees `priority` for an item about to take it, bumping the items at and
+    // below it down if the user agrees. Returns false if they decline.
+    bool make_room(const int priority) {
+        if (!store.has_priority(priority)) return true;
+        if (!confirm("\n  [!] Priority " + std::to_string(priority) + " already exists. Bump conflicting items down?")) {
+            return false;
         }
 
-        pause();
+        session.bump_from(priority);
+        return true;
+    }
+
+    // Acts on one search result: remove it, or move it to another priority
+    // (a regular item moves into the priority list)
+    void act_on(const TodoStore::ItemId id, const bool is_priority) {
+        output::print("\n\n  " CYAN, store.description(id), RESET "\n");
+        output::print("  [1] Remove\n");
+        output::print(is_priority ? "  [2] Change priority\n" : "  [2] Give it a priority\n");
+        output::print("  [3] Back\n\n");
+        output::print(YELLOW "  > Select action: " RESET);
+
+        const int action = answer();
+
+        // Regular items are removed by position
+        const std::vector<TodoStore::ItemId>& regular = store.regular_items();
+        const size_t position = is_priority ? 0 : static_cast<size_t>(std::find(regular.begin(), regular.end(), id) - regular.begin());
+
+        if (action == '1') {
+            if (!confirm("\n  Remove: " + store.description(id) + "?")) {
+                tell(RED "  [✗] Removal cancelled" RESET);
+            } else {
+                if (is_priority) session.remove_priority(id, store.priority_of(id));
+                else session.remove_regular(position);
+                tell(GREEN "  [✓] Item removed" RESET);
+            }
+        } else if (action == '2') {
+            int priority;
+            if (!ask_number(YELLOW "\n  Enter new priority: " RESET, priority)) {
+                tell(RED "  [✗] Change cancelled" RESET);
+            } else if (is_priority && store.priority_of(id) == priority) {
+                tell(CYAN "  [i] Item already has priority " + std::to_string(priority) + RESET);
+            } else if (!make_room(priority)) {
+                tell(RED "  [✗] Change cancelled" RESET);
+            } else if (is_priority) {
+                // Read the priority again: the bump may have moved this item too
+                session.reassign(id, store.priority_of(id), priority);
+                tell(GREEN "  [✓] Priority changed" RESET);
+            } else {
+                const std::string desc = store.description(id);
+                session.remove_regular(position);
+                session.add_priority(priority, desc);
+                tell(GREEN "  [✓] Moved to the priority list" RESET);
+            }
+        }
     }
 
-    void view_list() const
-    {
-        clear_screen();
-        draw_header();
-        std::cout << YELLOW << "  ═══ CHOOSE LIST TO VIEW ═══" << RESET << "\n\n";
-        std::cout << "  [1] Priority List\n";
-        std::cout << "  [2] Regular List\n\n";
-        std::cout << CYAN << "  > Select type: " << RESET;
+    // Matches are shown as the query is typed; ENTER picks one to act on
+    void search_items() {
+        struct Result {
+            bool is_priority;
+            int priority;
+            TodoStore::ItemId id;
+        };
 
-        int choice;
-        std::cin >> choice;
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::string query;
+        std::vector<Result> results;
+        while (true) {
+            // Looked up again after every key and action, either may change the matches
+            refresh();
+            const size_t shown = Screen::room(SEARCH_CHROME);
+            std::vector<TodoStore::ItemId> ids;
+            const bool more = !query.empty() && session.search(query, ids, shown + 1) > shown;
+            if (more) ids.pop_back();
+
+            // Priority items first, in priority order, then regular items
+            results.clear();
+            results.reserve(ids.size());
+            for (const TodoStore::ItemId id : ids) {
+                const bool is_priority = store.is_priority(id);
+                results.push_back(Result{is_priority, is_priority ? store.priority_of(id) : 0, id});
+            }
+            std::stable_sort(results.begin(), results.end(), [](const Result& a, const Result& b) {
+                if (a.is_priority != b.is_priority) return a.is_priority;
+                return a.priority < b.priority;
+            });
+
+            std::vector<std::string> lines;
+            for (size_t i = 0; i < results.size(); i++) {
+                const std::string tag = "[" + std::to_string(i + 1) + "] ";
+                if (results[i].is_priority) {
+                    lines.push_back(tag + "[" + std::to_string(results[i].priority) + "] " + store.description(results[i].id));
+                } else {
+                    lines.push_back(tag + "• " + store.description(results[i].id));
+                }
+            }
+            if (lines.empty()) lines.emplace_back(query.empty() ? "(type to search)" : "(no matches)");
+
+            std::string frame = top();
+            frame += YELLOW "  ═══ SEARCH ═══" RESET "\n\n";
+            frame += "  Finds text anywhere in a description, ignoring case.\n";
+            frame += "  Start with ^ to match only the beginning. [ENTER] select  [ESC] back\n\n";
+            boxes::render(frame, "MATCHES FOR \"" + query + "\"", lines, Theme::text, Theme::panel, "  ");
+            frame += more ? CYAN "  More matches not shown; refine the search to see them.\n" RESET : "\n";
+            frame += CYAN "\n  > Search for: " RESET + query;
+            screen.present(frame);
+
+            const int key = loop.key();
+            if (key == KEY_RESIZE) {
+                screen.invalidate();
+            } else if (key == KEY_ESCAPE || key == KEY_EOF || (key == KEY_ENTER && results.empty())) {
+                return;
+            } else if (key == KEY_BACKSPACE) {
+                while (!query.empty() && (static_cast<unsigned char>(query.back()) & 0xC0) == 0x80) query.pop_back();
+                if (!query.empty()) query.pop_back();
+            } else if (key == KEY_ENTER) {
+                int choice;
+                if (ask_number(YELLOW "\n\n  > Select match: " RESET, choice)
+                    && choice >= 1 && choice <= static_cast<int>(results.size())) {
+                    act_on(results[choice - 1].id, results[choice - 1].is_priority);
+                }
+            } else if (key >= ' ' && key < 256) {
+                query += static_cast<char>(key);
+            }
+        }
+    }
 
-        if (choice == 1) display_priority_list();
-        else display_regular_list();
+    void view_list() {
+        std::string frame = top();
+        frame += YELLOW "  ═══ CHOOSE LIST TO VIEW ═══" RESET "\n\n";
+        frame += "  [1] Priority List\n";
+        frame += "  [2] Regular List\n\n";
+        frame += CYAN "  > Select type: " RESET;
+        screen.present(frame);
+
+        const int choice = answer();
+        if (choice != '1' && choice != '2') return;
+
+        // Scroll until backed out of; a typed number jumps there
+        ListView& view = choice == '1' ? priority_view : regular_view;
+        int target;
+        while (browse(view, "", choice == '1' ? "  > Jump to priority: " : "  > Jump to item: ", VIEW_CHROME, false, target)) {
+            view.jump(target);
+        }
+    }
+
+    // The overview of every list in the workspace, from the manifest; only
+    // lists already open show live counts. True with the list to open in
+    // `chosen`, which may be a new one.
+    bool pick_list(std::string& chosen) {
+        workspace.refresh();
+        size_t first = 0;
+        std::string typed;
+        std::vector<std::string> lines;
+        while (true) {
+            refresh();
+            const std::vector<Workspace::Entry>& lists = workspace.lists();
+            const size_t rows = Screen::room(LISTS_CHROME);
+            if (first + rows > lists.size()) first = lists.size() > rows ? lists.size() - rows : 0;
+
+            lines.clear();
+            for (size_t i = first; i < lists.size() && i < first + rows; i++) {
+                const Workspace::Entry& entry = lists[i];
+                std::string counts = "not opened yet";
+                if (entry.counted) {
+                    counts = std::to_string(entry.priority_items) + " priority, "
+                             + std::to_string(entry.regular_items) + " regular";
+                }
+                char line[128];
+                std::snprintf(line, sizeof(line), "%c [%zu] %-40s %-34s", entry.name == list_name ? '*' : ' ',
+                              i + 1, Workspace::label(entry.name).c_str(), counts.c_str());
+                lines.push_back(line);
+            }
 
-        pause();
-        clear_screen();
+            std::string frame = top();
+            frame += YELLOW "  ═══ LISTS ═══" RESET "\n\n";
+            boxes::render(frame, "LISTS " + std::to_string(first + 1) + "-" + std::to_string(first + lines.size())
+                                 + " of " + std::to_string(lists.size()), lines, Theme::text, Theme::panel, "  ");
+            frame += "\n" CYAN "  [a] add list  [j/k] scroll  [n/p] page  [ESC] back" RESET "\n";
+            frame += YELLOW "  > Open list: " RESET + typed;
+            screen.present(frame);
+
+            const int key = loop.key();
+            if (key == KEY_RESIZE) {
+                screen.invalidate();
+            } else if (key >= '0' && key <= '9') {
+                if (typed.size() < 9) typed += static_cast<char>(key);
+            } else if (key == KEY_BACKSPACE) {
+                if (!typed.empty()) typed.pop_back();
+            } else if (key == KEY_ENTER && !typed.empty()) {
+                const size_t number = static_cast<size_t>(std::atol(typed.c_str()));
+                typed.clear();
+                if (number < 1 || number > lists.size()) {
+                    tell(RED "  [✗] No list with that number" RESET);
+                    continue;
+                }
+                chosen = lists[number - 1].name;
+                return true;
+            } else if (key == 'a') {
+                output::print(YELLOW "\n  Name of the new list: " RESET);
+                std::string name;
+                if (!loop.line(name) || name.empty()) continue;
+                if (!workspace.create(name)) {
+                    tell(RED "  [✗] Could not add the list: " + workspace.error() + RESET);
+                    continue;
+                }
+                chosen = name;
+                return true;
+            } else if (key == KEY_DOWN || key == 'j') {
+                first++;
+            } else if ((key == KEY_UP || key == 'k') && first > 0) {
+                first--;
+            } else if (key == KEY_PAGE_DOWN || key == 'n') {
+                first += rows;
+            } else if (key == KEY_PAGE_UP || key == 'p') {
+                first = first > rows ? first - rows : 0;
+            } else if (key == KEY_ENTER || key == KEY_ESCAPE || key == KEY_EOF || key == 'q') {
+                return false;
+            }
+        }
     }
 
-    static void pause() {
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        std::cout << "\n" << CYAN << "  Press ENTER to continue..." << RESET;
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    // Hidden 's' key: the hot-path statistics (see stats.h), redrawn as they
+    // come in until any other key
+    void show_stats() {
+        if (!stats::compiled()) {
+            tell(CYAN "  [i] Built without statistics (configure with -DTODO_BBS_STATS=ON)" RESET);
+            return;
+        }
+        if (!stats::enabled()) {
+            tell(CYAN "  [i] Set TODO_BBS_STATS=1, or to a file to dump them to, to collect statistics" RESET);
+            return;
+        }
+
+        std::vector<std::string> lines;
+        while (true) {
+            refresh();
+            std::string frame = top();
+            frame += YELLOW "  ═══ STATISTICS ═══" RESET "\n\n";
+            lines.clear();
+            const std::string summary = stats::summary();
+            for (size_t start = 0, end; start < summary.size(); start = end + 1) {
+                end = summary.find('\n', start);
+                if (end == std::string::npos) end = summary.size();
+                lines.push_back(summary.substr(start, end - start));
+            }
+            boxes::render(frame, "HOT PATHS", lines, Theme::text, Theme::panel, "  ");
+            frame += CYAN "\n  p50 and p99 are rounded up to a power of two\n" RESET;
+            frame += YELLOW "\n  > Any key to go back " RESET;
+            screen.present(frame);
+
+            const int key = loop.choice();
+            if (key == KEY_REDRAW) continue;
+            if (key == KEY_RESIZE) {
+                screen.invalidate();
+                continue;
+            }
+            return;
+        }
     }
 
-    void show_menu() const
-    {
-        draw_separator("=");
-        std::cout << CYAN << "  [1] View TODO List\n";
-        std::cout << "  [2] Add Item\n";
-        std::cout << "  [3] Remove Item\n";
-        std::cout << "  [4] " << (has_changes ? YELLOW + std::string("[*] ") + CYAN : "")
-                  << "Commit Changes\n" << RESET;
-        std::cout << CYAN << "  [5] Exit (discard uncommitted changes)\n";
-        draw_separator("=");
-        std::cout << YELLOW << "\n  > Enter command: " << RESET;
+    // All but the changes marker and the exit line is laid out at compile time
+    std::string menu() const {
+        static constexpr auto head = join(rule_line<Theme, '='>, literal(Theme::text),
+                                          literal("  [1] View TODO List\n  [2] Add Item\n  [3] Remove Item\n  [4] "));
+        static constexpr auto marker = join(literal(YELLOW "[*] "), literal(Theme::text));
+        static constexpr auto middle = join(literal("Commit Changes\n" RESET), literal(Theme::text),
+                                            literal("  [f] Search  [o] Reorder\n  [u] Undo  [r] Redo  [w] Lists\n"));
+        static constexpr auto tail = join(rule_line<Theme, '='>, literal(YELLOW "\n  > Enter command: " RESET));
+
+        std::string text(head);
+        if (session.has_changes()) text += marker;
+        text += middle;
+        text += autosave_ms > 0 ? "  [5] Exit (saves changes)\n" : "  [5] Exit (discard uncommitted changes)\n";
+        text += tail;
+        return text;
     }
 
 public:
-    TodoBBS(std::string  pri_file, std::string  reg_file)
-        : priority_file(std::move(pri_file)), regular_file(std::move(reg_file)), has_changes(false) {
-        load_from_file(priority_file, priority_list, true);
-        load_from_file(regular_file, regular_list, false);
+    // `session` is list `name` of `workspace`, loaded
+    TodoBBS(EventLoop& loop, Workspace& workspace, const std::string& name, TodoSession& session)
+        : loop(loop), workspace(workspace), list_name(name), session(session), store(session.lists()),
+          priority_view(store, true, "PRIORITY TODO LIST" + list_title(name), Theme::text, Theme::priority),
+          regular_view(store, false, "REGULAR TODO LIST" + list_title(name), Theme::text, Theme::regular),
+          notice_timer(0), autosave_ms(0), autosave_timer(0), autosave_due(false) {
+        session.keep_history(true);
+        // Called on the watcher thread, and kept by the session once this
+        // screen is gone, so it only wakes the loop; refresh() syncs
+        EventLoop& events = loop;
+        session.watch([&events]() {
+            events.post([&events]() { events.redraw(); });
+        });
     }
 
-    void run() {
+    ~TodoBBS() {
+        loop.cancel(notice_timer);
+        loop.cancel(autosave_timer);
+    }
+
+    // Returns false on exit, or true with the list to switch to in `next`
+    bool run(std::string& next) {
         while (true) {
-            clear_screen();
-            draw_header();
-            display_priority_list();
-            display_regular_list();
-            show_menu();
-            
-            int choice;
-            std::cin >> choice;
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            
+            refresh();
+            fit_lists(MAIN_CHROME);
+            std::string frame = top();
+            frame += priority_view.render(session.revision());
+            frame += regular_view.render(session.revision());
+            frame += menu();
+            screen.present(frame);
+
+            const int choice = loop.choice();
             switch (choice) {
-                case 1:
+                case '1':
                     view_list();
                     break;
-                case 2:
+                case '2':
                     add_item();
                     break;
-                case 3:
+                case '3':
                     remove_item();
                     break;
-                case 4:
+                case '4':
                     commit_changes();
                     break;
-                case 5:
-                    if (has_changes) {
-                        std::cout << RED << "\n  [!] You have uncommitted changes. Exit anyway? (y/n): " << RESET;
-                        char confirm;
-                        std::cin >> confirm;
-                        if (confirm == 'y' || confirm == 'Y') {
-                            std::cout << "\n" << CYAN << "  ═══ Thanks for using TODO-BBS! ═══" << RESET << "\n\n";
-                            return;
-                        }
-                    } else {
-                        std::cout << "\n" << CYAN << "  ═══ Thanks for using TODO-BBS! ═══" << RESET << "\n\n";
-                        return;
+                case 'f':
+                    search_items();
+                    break;
+                case 'o':
+                    reorder_items();
+                    break;
+                case 'u':
+                    if (!session.can_undo()) tell(CYAN "  [i] Nothing to undo" RESET);
+                    else if (session.undo()) tell(GREEN "  [✓] Undone" RESET);
+                    else tell(RED "  [✗] The lists changed too much to undo that; history cleared" RESET);
+                    break;
+                case 'r':
+                    if (!session.can_redo()) tell(CYAN "  [i] Nothing to redo" RESET);
+                    else if (session.redo()) tell(GREEN "  [✓] Redone" RESET);
+                    else tell(RED "  [✗] The lists changed too much to redo that; history cleared" RESET);
+                    break;
+                case 's':
+                    show_stats();
+                    break;
+                case 'w':
+                    if (!pick_list(next) || next == list_name) break;
+                    // Lists left behind stay open, but autosave stops with the screen
+                    if (autosave_ms > 0 && !session.commit()) {
+                        tell(RED "  [ERROR] Could not save; commit before switching lists" RESET);
+                        break;
+                    }
+                    return true;
+                case '5':
+                case KEY_EOF:
+                    if (autosave_ms > 0 && !session.commit()) {
+                        output::print(RED "\n  [ERROR] Could not save to: ", session.priority_path(), RESET "\n");
+                        if (choice == KEY_EOF) return false;
+                        tell(RED "  [ERROR] Could not save; commit or exit again" RESET);
+                        autosave_ms = 0;
+                        break;
+                    }
+                    // Nobody is left to ask once input has ended
+                    if (choice == '5' && workspace.unsaved() > 0
+                        && !confirm(workspace.unsaved() > 1 ? "\n  [!] You have uncommitted changes in "
+                                                              + std::to_string(workspace.unsaved()) + " lists. Exit anyway?"
+                                                            : "\n  [!] You have uncommitted changes. Exit anyway?")) {
+                        break;
                     }
+                    output::print("\n" CYAN "  ═══ Thanks for using TODO-BBS! ═══" RESET "\n\n");
+                    return false;
+                case KEY_RESIZE:
+                    screen.invalidate();
+                    break;
+                case KEY_REDRAW:
+                case KEY_ENTER:
                     break;
                 default:
-                    std::cout << RED << "\n  [✗] Invalid option" << RESET << "\n";
-                    pause();
+                    tell(RED "  [✗] Invalid option" RESET);
             }
         }
     }
@@ -517,58 +860,175 @@ std::string get_home_directory() {
     return home ? std::string(home) : ".";
 }
 
-std::pair<std::string, std::string> select_file_paths() {
-    std::cout << CYAN << BOLD;
-    std::cout << "\n╔════════════════════════════════════════════════════════════════════╗\n";
-    std::cout << "║              ░▒▓ TODO-BBS " + std::string(VERSION) + " ▓▒░                               ║\n";
-    std::cout << "║              Your Retro Task Manager                               ║\n";
-    std::cout << "╚════════════════════════════════════════════════════════════════════╝\n";
-    std::cout << RESET << "\n";
+// Global lists live in Documents/todo/, local ones in the current directory
+std::pair<std::string, std::string> list_paths(const bool global) {
+    if (!global) return {"priority_todo.txt", "regular_todo.txt"};
+
+    const std::string home = get_home_directory();
+    const std::string todo_dir = home + "/Documents/todo";
+
+    // Create directory if it doesn't exist
+    #ifdef _WIN32
+        system(("mkdir \"" + todo_dir + "\" 2>nul").c_str());
+    #else
+        system(("mkdir -p \"" + todo_dir + "\"").c_str());
+    #endif
+
+    return {todo_dir + "/priority_todo.txt", todo_dir + "/regular_todo.txt"};
+}
+
+// Asks where the lists live; `location` says what was picked
+std::pair<std::string, std::string> select_file_paths(EventLoop& loop, std::string& location) {
+    output::print(CYAN BOLD);
+    output::print("\n╔════════════════════════════════════════════════════════════════════╗\n");
+    output::print("║              ░▒▓ TODO-BBS " VERSION " ▓▒░                               ║\n");
+    output::print("║              Your Retro Task Manager                               ║\n");
+    output::print("╚════════════════════════════════════════════════════════════════════╝\n");
+    output::print(RESET "\n");
     
-    std::cout << YELLOW << "  ═══ FILE LOCATION SETUP ═══" << RESET << "\n\n";
-    std::cout << "  [1] Local - Use TODO lists in current directory\n";
-    std::cout << "  [2] Global - Use TODO lists in Documents/todo/\n\n";
-    std::cout << CYAN << "  > Select mode: " << RESET;
+    output::print(YELLOW "  ═══ FILE LOCATION SETUP ═══" RESET "\n\n");
+    output::print("  [1] Local - Use TODO lists in current directory\n");
+    output::print("  [2] Global - Use TODO lists in Documents/todo/\n\n");
+    output::print(CYAN "  > Select mode: " RESET);
     
     int choice;
-    std::cin >> choice;
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    do choice = loop.choice(); while (choice == KEY_REDRAW || choice == KEY_RESIZE);
     
-    std::string priority_file, regular_file;
+    const std::pair<std::string, std::string> paths = list_paths(choice == '2');
     
-    if (choice == 2) {
-        const std::string home = get_home_directory();
-        const std::string todo_dir = home + "/Documents/todo";
-        
-        // Create directory if it doesn't exist
-        #ifdef _WIN32
-            system(("mkdir \"" + todo_dir + "\" 2>nul").c_str());
-        #else
-            system(("mkdir -p \"" + todo_dir + "\"").c_str());
-        #endif
-        
-        priority_file = todo_dir + "/priority_todo.txt";
-        regular_file = todo_dir + "/regular_todo.txt";
-        
-        std::cout << GREEN << "\n  [✓] Using global TODO lists: " << todo_dir << RESET << "\n";
+    if (choice == '2') {
+        location = GREEN "  [✓] Using global TODO lists: " + get_home_directory() + "/Documents/todo" RESET;
     } else {
-        priority_file = "priority_todo.txt";
-        regular_file = "regular_todo.txt";
-        
-        std::cout << GREEN << "\n  [✓] Using local TODO lists in current directory" << RESET << "\n";
+        location = GREEN "  [✓] Using local TODO lists in current directory" RESET;
     }
     
-    std::cout << CYAN << "\n  Press ENTER to continue..." << RESET;
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    
-    return {priority_file, regular_file};
+    return paths;
 }
 
-int main() {
-    const std::pair<std::string, std::string> file_paths = select_file_paths();
-    
-    TodoBBS app(file_paths.first, file_paths.second);
-    app.run();
-    
+// Runs the menus on the default list of the chosen location, and on each
+// list picked from there; `notice` is shown first
+int run_workspace(EventLoop& loop, const std::pair<std::string, std::string>& paths, std::string notice) {
+    Workspace workspace(paths.first, paths.second);
+
+    // TODO_BBS_AUTOSAVE=<seconds> turns autosave on
+    const char* autosave = std::getenv("TODO_BBS_AUTOSAVE");
+    const int autosave_ms = autosave ? static_cast<int>(std::atof(autosave) * 1000) : 0;
+
+    std::string name;  // the default list
+    while (true) {
+        TodoSession* session = workspace.open(name);
+        if (!session) {
+            output::print(RED "  [ERROR] Could not read ", workspace.error(), RESET "\n");
+            return 1;
+        }
+
+        TodoBBS<RetroTheme> app(loop, workspace, name, *session);
+        app.tell(notice);
+        app.autosave(autosave_ms);
+        std::string next;
+        const bool switching = app.run(next);
+        workspace.note(name, *session);
+        if (!switching) return 0;
+
+        // Stays on the same list if the one picked cannot be read
+        if (workspace.open(next)) {
+            notice = GREEN "  [✓] Opened list: " + Workspace::label(next) + RESET;
+            name = next;
+        } else {
+            notice = RED "  [ERROR] Could not read " + workspace.error() + RESET;
+        }
+    }
+}
+
+// Headless commands: todo-bbs [--global] [--list <name>] add|rm|ls|import ...
+int run_batch(const int argc, char** argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    bool global = false;
+    std::string name;
+    // The location options, in either order, before the command
+    while (!args.empty()) {
+        if (args[0] == "--global") {
+            global = true;
+            args.erase(args.begin());
+        } else if (args.size() >= 2 && args[0] == "--list") {
+            name = args[1];
+            args.erase(args.begin(), args.begin() + 2);
+        } else {
+            break;
+        }
+    }
+
+    const std::pair<std::string, std::string> paths = list_paths(global);
+    Workspace workspace(paths.first, paths.second);
+    if (!workspace.exists(name)) {
+        std::cout << RED << "  [ERROR] There is no list called " << name << " (add it with [w] on the main menu)"
+                  << RESET << "\n";
+        return 1;
+    }
+
+    std::unique_ptr<TodoSession> session = workspace.session(name);
+    const int status = batch::run(*session, args);
+    // ls changes nothing, so leaves the manifest be
+    if (status == 0 && args[0] != "ls") workspace.note(name, *session);
+    session.reset();  // lets a background fold finish, and be counted
+    if (!stats::dump()) std::cout << RED << "  [ERROR] Could not write statistics to: " << std::getenv("TODO_BBS_STATS") << RESET << "\n";
+    return status;
+}
+
+// Format conversions: todo-bbs --to-binary | --to-text <from...> <to...>
+int convert_lists(const int argc, char** argv) {
+    const std::string command = argv[1];
+    bool ok;
+    std::string error;
+
+    if (command == "--to-binary" && argc == 5) {
+        // A missing text list reads as empty, so a mistyped pair would
+        // otherwise make an empty store that then shadows the real lists
+        TodoSession source(argv[2], argv[3]);
+        if (!todofile::exists(argv[2]) && !todofile::exists(argv[3])) {
+            ok = false;
+            error = std::string("neither ") + argv[2] + " nor " + argv[3] + " exists";
+        } else {
+            ok = source.load() && source.export_binary(argv[4]);
+            error = source.error();
+        }
+    } else if (command == "--to-text" && argc == 5) {
+        TodoSession source(argv[2]);
+        ok = source.load() && source.export_text(argv[3], argv[4]);
+        error = source.error();
+    } else {
+        std::cout << "Usage: todo-bbs [--to-binary <priority.txt> <regular.txt> <store.tdb>]\n"
+                  << "                [--to-text <store.tdb> <priority.txt> <regular.txt>]\n";
+        batch::usage();
+        return command == "--help" ? 0 : 2;
+    }
+
+    if (!ok) {
+        std::cout << RED << "  [ERROR] Conversion failed" << (error.empty() ? "" : ": " + error) << RESET << "\n";
+        return 1;
+    }
+    std::cout << GREEN << "  [✓] Converted to " << argv[argc - (command == "--to-binary" ? 1 : 2)] << RESET << "\n";
     return 0;
 }
+
+int main(int argc, char** argv) {
+    // Screens go out through output.h; std::cout is only for the headless
+    // commands, which need no stdio buffering of their own underneath
+    std::ios::sync_with_stdio(false);
+
+    if (argc > 1) {
+        const std::string command = argv[1];
+        if (command.compare(0, 2, "--") == 0 && command != "--global" && command != "--list") {
+            return convert_lists(argc, argv);
+        }
+        return run_batch(argc, argv);
+    }
+
+    EventLoop loop;
+    std::string location;
+    const std::pair<std::string, std::string> file_paths = select_file_paths(loop, location);
+    const int status = run_workspace(loop, file_paths, location);
+    if (!stats::dump()) std::cout << RED << "  [ERROR] Could not write statistics to: " << std::getenv("TODO_BBS_STATS") << RESET << "\n";
+
+    return status;
+}
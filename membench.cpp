@@ -0,0 +1,109 @@
+// Memory footprint of a loaded priority list: heap allocations, bytes
+// requested and resident set size, old representation vs TodoStore.
+// Usage: todo-bbs-membench [lines]
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench_util.h"
+#include "priority_index.h"
+#include "todo_file.h"
+
+static size_t allocation_count = 0;
+static size_t allocated_bytes = 0;
+
+void* operator new(const size_t size) {
+    allocation_count++;
+    allocated_bytes += size;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+long current_rss_kb() {
+    long pages = 0, resident = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+    if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    std::fclose(statm);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void print_usage(const char* name, const long baseline_kb) {
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "  " << name << ": "
+              << allocation_count << " allocations, "
+              << (allocated_bytes / 1024) << " KiB requested, "
+              << "RSS " << (current_rss_kb() - baseline_kb) << " KiB, "
+              << "peak RSS " << usage.ru_maxrss << " KiB\n";
+}
+
+void load_legacy(const std::string& path) {
+    const long baseline = current_rss_kb();
+    allocation_count = allocated_bytes = 0;
+
+    std::vector<LegacyItem> loaded;
+    legacy_load(path, loaded);
+    std::vector<std::pair<int, std::string>> entries;
+    entries.reserve(loaded.size());
+    for (auto& item : loaded) entries.emplace_back(item.priority, std::move(item.description));
+    std::vector<LegacyItem>().swap(loaded);
+
+    PriorityIndex<std::string> index;
+    index.assign(entries);
+    std::vector<std::pair<int, std::string>>().swap(entries);
+
+    print_usage("string per item", baseline);
+}
+
+void load_store(const std::string& path) {
+    const long baseline = current_rss_kb();
+    allocation_count = allocated_bytes = 0;
+
+    TodoStore store;
+    todofile::load(path, store, true);
+
+    print_usage("TodoStore      ", baseline);
+}
+
+// Runs each scenario in its own process so peak RSS is not shared
+void run_isolated(void (*scenario)(const std::string&), const std::string& path) {
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid == 0) {
+        scenario(path);
+        std::cout.flush();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+}
+
+}
+
+int main(int argc, char** argv) {
+    const size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::string path = "/tmp/todo-bbs-membench-priority.txt";
+    write_priority_file(path, lines);
+
+    std::cout << "resident priority list, " << lines << " lines\n";
+    run_isolated(load_legacy, path);
+    run_isolated(load_store, path);
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include "output.h"
+#include "todo_file.h"
+#include <iostream>
+
+#ifndef _WIN32
+    #include <unistd.h>
+#endif
+
+std::string& output::buffer() {
+    // Kept across flushes, so its capacity is reused frame after frame
+    static std::string pending_output;
+    return pending_output;
+}
+
+void output::flush() {
+    std::cout.flush();
+    std::string& out = buffer();
+    if (out.empty()) return;
+
+    #ifndef _WIN32
+        // A failed write leaves nowhere to show it; it is dropped
+        todofile::write_all(STDOUT_FILENO, out.data(), out.size());
+    #else
+        std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+        std::cout.flush();
+    #endif
+    out.clear();
+}
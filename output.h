@@ -0,0 +1,36 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// The one buffer everything the interactive screens show goes through:
+// frames, prompts, answers and messages alike. Nothing reaches the
+// terminal until flush(), which writes the lot with a single write(2);
+// Screen::present() flushes, and so does every wait for input, so a
+// prompt is always on screen before its answer is read.
+//
+// std::cout is kept for the headless commands; flush() empties it first,
+// so the two never come out of order.
+class output {
+public:
+    template <typename... Parts>
+    static void print(const Parts&... parts) {
+        (append(parts), ...);
+    }
+
+    static void flush();
+    // Bytes waiting for the next flush()
+    static size_t pending() { return buffer().size(); }
+
+private:
+    static std::string& buffer();
+
+    static void append(const std::string_view text) { buffer() += text; }
+    static void append(const char c) { buffer() += c; }
+    template <typename Number, typename = typename std::enable_if<std::is_integral<Number>::value>::type>
+    static void append(const Number number) { buffer() += std::to_string(number); }
+};
+
+#endif
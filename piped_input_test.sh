@@ -0,0 +1,21 @@
+#!/bin/sh
+# Drives the menus through a pipe, one answer per line, the way a script
+# would, and checks the edits were committed. Usage: piped_input_test.sh <todo-bbs>
+set -e
+bin="$1"
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir"
+
+# Local mode, add a regular item, commit, exit
+printf '1\n2\n2\nhello world\n4\ny\n5\n' | HOME="$dir" "$bin" > screen.log
+if grep -q "Invalid option" screen.log; then
+    echo "a line end was taken for a menu key"
+    exit 1
+fi
+[ "$("$bin" ls regular)" = "hello world" ] || { echo "regular item not committed"; exit 1; }
+
+# Add priority 5, remove it again by typing its number, with CRLF line ends
+printf '1\r\n2\r\n1\r\n5\r\nfive\r\n4\r\ny\r\n3\r\n1\r\n5\r\ny\r\n4\r\ny\r\n5\r\n' | HOME="$dir" "$bin" > screen.log
+[ -z "$("$bin" ls priority)" ] || { echo "priority item not removed"; exit 1; }
+echo "piped input ok"
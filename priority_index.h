@@ -0,0 +1,435 @@
+#ifndef PRIORITY_INDEX_H
+#define PRIORITY_INDEX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Ordered multiset of (priority, value) pairs.
+// Backed by a treap whose nodes live in one contiguous pool. Every node carries
+// a pending priority offset for its children, so "bump every priority >= p"
+// is a split, a tag and a merge instead of a walk over the whole list.
+// Lookup, insert, bump and erase are all O(log n) expected. Nodes also link
+// to their parent, so an entry's current priority can be read back from the
+// handle insert() returned, after any number of bumps.
+template <typename T>
+class PriorityIndex {
+public:
+    PriorityIndex() : root(NIL), free_head(NIL) {}
+
+    size_t size() const { return root == NIL ? 0 : nodes[root].size; }
+    bool empty() const { return root == NIL; }
+
+    void clear() {
+        nodes.clear();
+        root = NIL;
+        free_head = NIL;
+    }
+
+    typedef uint32_t Handle;
+
+    // Replaces the contents with `entries`. Input that is already sorted (every
+    // file we save is) is built in one linear pass instead of n inserts.
+    // The i-th entry (after sorting) gets handle i.
+    void assign(std::vector<std::pair<int, T>>& entries) {
+        clear();
+        if (!std::is_sorted(entries.begin(), entries.end(), key_less)) {
+            std::stable_sort(entries.begin(), entries.end(), key_less);
+        }
+        nodes.reserve(entries.size());
+
+        // Cartesian tree construction over the right spine
+        std::vector<uint32_t> spine;
+        for (auto& entry : entries) {
+            const uint32_t node = allocate(entry.first, std::move(entry.second));
+            uint32_t last = NIL;
+            while (!spine.empty() && heap(spine.back()) < heap(node)) {
+                last = spine.back();
+                spine.pop_back();
+            }
+            set_left(node, last);
+            if (!spine.empty()) set_right(spine.back(), node);
+            spine.push_back(node);
+        }
+        set_root(spine.empty() ? NIL : spine.front());
+        update_sizes(root);
+    }
+
+    // First value stored under `priority`, or nullptr if the priority is free
+    const T* find(const int priority) const {
+        const T* found = nullptr;
+        uint32_t t = root;
+        int offset = 0;
+        while (t != NIL) {
+            const Node& n = nodes[t];
+            const int key = n.key + offset;
+            if (key == priority) found = &n.value;  // an earlier one may be to the left
+            offset += n.lazy;
+            t = priority <= key ? n.left : n.right;
+        }
+        return found;
+    }
+
+    bool contains(const int priority) const { return find(priority) != nullptr; }
+
+    // Inserts after any existing entries with the same priority. The handle
+    // stays valid until this entry is erased.
+    Handle insert(const int priority, T value) {
+        const uint32_t node = allocate(priority, std::move(value));
+        uint32_t lo, hi;
+        split_after(root, priority, lo, hi);
+        set_root(merge(merge(lo, node), hi));
+        return node;
+    }
+
+    // Current priority of the entry behind `handle`: its key plus the
+    // offsets still pending in its ancestors. O(depth).
+    int priority_of(const Handle handle) const {
+        int priority = nodes[handle].key;
+        for (uint32_t t = nodes[handle].parent; t != NIL; t = nodes[t].parent) priority += nodes[t].lazy;
+        return priority;
+    }
+
+    // Adds 1 to every priority >= starting_priority
+    void bump_from(const int starting_priority) { shift_from(starting_priority, 1); }
+
+    // Adds `delta` to every priority >= starting_priority. A negative delta
+    // must not take them past the priorities below them, or order is lost.
+    void shift_from(const int starting_priority, const int delta) {
+        uint32_t lo, hi;
+        split(root, starting_priority, lo, hi);
+        apply(hi, delta);
+        set_root(merge(lo, hi));
+    }
+
+    // Removes one entry with this priority; returns false if there is none
+    bool erase(const int priority, T* removed = nullptr) {
+        uint32_t lo, mid, hi;
+        split_out(priority, lo, mid, hi);
+        const bool found = mid != NIL;
+        if (found) {
+            push(mid);
+            if (removed) *removed = std::move(nodes[mid].value);
+            const uint32_t rest = merge(nodes[mid].left, nodes[mid].right);
+            release(mid);
+            mid = rest;
+        }
+        set_root(merge(merge(lo, mid), hi));
+        return found;
+    }
+
+    // Removes the entry with this priority whose value equals `value`.
+    // Needed when duplicate priorities exist (e.g. after a manual reassign).
+    bool erase(const int priority, const T& value) {
+        uint32_t lo, mid, hi;
+        split_out(priority, lo, mid, hi);
+        const bool found = remove_value(mid, value);
+        set_root(merge(merge(lo, mid), hi));
+        return found;
+    }
+
+    class const_iterator;
+
+    // In-order traversal; entries come out sorted by priority without copying
+    const_iterator begin() const { return const_iterator(nodes, root, nullptr); }
+    const_iterator end() const { return const_iterator(nodes); }
+
+    // First entry with priority >= `priority`
+    const_iterator lower_bound(const int priority) const { return const_iterator(nodes, root, &priority); }
+
+    // The entry at position `rank` in priority order (0 is the first), or
+    // end(). O(log n), so a window can start anywhere in a long list.
+    const_iterator at(const size_t rank) const {
+        const_iterator it(nodes);
+        if (rank < size()) it.seek(root, rank);
+        return it;
+    }
+
+    // Number of entries with a priority below `priority`
+    size_t rank(const int priority) const {
+        size_t below = 0;
+        uint32_t t = root;
+        int offset = 0;
+        while (t != NIL) {
+            const Node& n = nodes[t];
+            if (n.key + offset < priority) {
+                below += size_of(n.left) + 1;
+                t = n.right;
+            } else {
+                t = n.left;
+            }
+            offset += n.lazy;
+        }
+        return below;
+    }
+
+private:
+    static constexpr uint32_t NIL = 0xFFFFFFFFu;
+
+    struct Node {
+        int key;        // priority, minus offsets still pending in ancestors
+        int lazy;       // offset not yet pushed into the children
+        uint32_t left;
+        uint32_t right;
+        uint32_t parent;
+        uint32_t size;
+        T value;
+    };
+
+    std::vector<Node> nodes;
+    uint32_t root;
+    uint32_t free_head;  // released nodes, chained through `left`
+
+    // Treap priority of a node, derived from its pool slot instead of stored.
+    // A full-avalanche mix (murmur3 finalizer) is as good as a random draw
+    // and keeps every node four bytes smaller.
+    static uint32_t heap(uint32_t id) {
+        id ^= id >> 16;
+        id *= 0x85EBCA6Bu;
+        id ^= id >> 13;
+        id *= 0xC2B2AE35u;
+        id ^= id >> 16;
+        return id;
+    }
+
+    uint32_t allocate(const int key, T value) {
+        uint32_t id;
+        if (free_head != NIL) {
+            id = free_head;
+            free_head = nodes[id].left;
+        } else {
+            id = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(Node());
+        }
+        Node& n = nodes[id];
+        n.key = key;
+        n.lazy = 0;
+        n.left = NIL;
+        n.right = NIL;
+        n.parent = NIL;
+        n.size = 1;
+        n.value = std::move(value);
+        return id;
+    }
+
+    void release(const uint32_t id) {
+        nodes[id].value = T();
+        nodes[id].left = free_head;
+        free_head = id;
+    }
+
+    uint32_t size_of(const uint32_t t) const { return t == NIL ? 0 : nodes[t].size; }
+
+    // Child links always go through these so parent links stay in step
+    void set_left(const uint32_t t, const uint32_t child) {
+        nodes[t].left = child;
+        if (child != NIL) nodes[child].parent = t;
+    }
+
+    void set_right(const uint32_t t, const uint32_t child) {
+        nodes[t].right = child;
+        if (child != NIL) nodes[child].parent = t;
+    }
+
+    void set_root(const uint32_t t) {
+        root = t;
+        if (t != NIL) nodes[t].parent = NIL;
+    }
+
+    void update(const uint32_t t) {
+        nodes[t].size = 1 + size_of(nodes[t].left) + size_of(nodes[t].right);
+    }
+
+    static bool key_less(const std::pair<int, T>& a, const std::pair<int, T>& b) { return a.first < b.first; }
+
+    uint32_t update_sizes(const uint32_t t) {
+        if (t == NIL) return 0;
+        nodes[t].size = 1 + update_sizes(nodes[t].left) + update_sizes(nodes[t].right);
+        return nodes[t].size;
+    }
+
+    void apply(const uint32_t t, const int delta) {
+        if (t == NIL) return;
+        nodes[t].key += delta;
+        nodes[t].lazy += delta;
+    }
+
+    void push(const uint32_t t) {
+        if (nodes[t].lazy == 0) return;
+        apply(nodes[t].left, nodes[t].lazy);
+        apply(nodes[t].right, nodes[t].lazy);
+        nodes[t].lazy = 0;
+    }
+
+    // Splits `t` into keys < key (lo) and keys >= key (hi)
+    void split(const uint32_t t, const int key, uint32_t& lo, uint32_t& hi) {
+        if (t == NIL) {
+            lo = hi = NIL;
+            return;
+        }
+        push(t);
+        if (nodes[t].key < key) {
+            uint32_t right;
+            split(nodes[t].right, key, right, hi);
+            set_right(t, right);
+            lo = t;
+        } else {
+            uint32_t left;
+            split(nodes[t].left, key, lo, left);
+            set_left(t, left);
+            hi = t;
+        }
+        update(t);
+    }
+
+    // Splits the whole tree into keys < key, == key and > key
+    void split_out(const int key, uint32_t& lo, uint32_t& mid, uint32_t& hi) {
+        uint32_t rest;
+        split(root, key, lo, rest);
+        split_after(rest, key, mid, hi);
+    }
+
+    // Splits `t` into keys <= key (lo) and keys > key (hi)
+    void split_after(const uint32_t t, const int key, uint32_t& lo, uint32_t& hi) {
+        if (t == NIL) {
+            lo = hi = NIL;
+            return;
+        }
+        push(t);
+        if (nodes[t].key <= key) {
+            uint32_t right;
+            split_after(nodes[t].right, key, right, hi);
+            set_right(t, right);
+            lo = t;
+        } else {
+            uint32_t left;
+            split_after(nodes[t].left, key, lo, left);
+            set_left(t, left);
+            hi = t;
+        }
+        update(t);
+    }
+
+    uint32_t merge(const uint32_t a, const uint32_t b) {
+        if (a == NIL) return b;
+        if (b == NIL) return a;
+        if (heap(a) > heap(b)) {
+            push(a);
+            const uint32_t right = merge(nodes[a].right, b);
+            set_right(a, right);
+            update(a);
+            return a;
+        }
+        push(b);
+        const uint32_t left = merge(a, nodes[b].left);
+        set_left(b, left);
+        update(b);
+        return b;
+    }
+
+    // Removes the first node equal to `value` from a subtree of equal keys
+    bool remove_value(uint32_t& t, const T& value) {
+        if (t == NIL) return false;
+        push(t);
+        if (nodes[t].value == value) {
+            const uint32_t gone = t;
+            t = merge(nodes[gone].left, nodes[gone].right);
+            release(gone);
+            return true;
+        }
+        uint32_t child = nodes[t].left;
+        bool found = remove_value(child, value);
+        set_left(t, child);
+        if (!found) {
+            child = nodes[t].right;
+            found = remove_value(child, value);
+            set_right(t, child);
+        }
+        if (found) update(t);
+        return found;
+    }
+
+public:
+    // Walks the tree with an explicit stack, adding up the offsets still
+    // pending on the path so a const traversal sees the real priorities
+    class const_iterator {
+    public:
+        std::pair<int, const T&> operator*() const {
+            const Frame& top = stack.back();
+            const Node& n = (*pool)[top.node];
+            return std::pair<int, const T&>(n.key + top.offset, n.value);
+        }
+
+        const_iterator& operator++() {
+            const Frame top = stack.back();
+            stack.pop_back();
+            const Node& n = (*pool)[top.node];
+            descend(n.right, top.offset + n.lazy, nullptr);
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            if (stack.empty() || other.stack.empty()) return stack.empty() == other.stack.empty();
+            return stack.back().node == other.stack.back().node;
+        }
+
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class PriorityIndex;
+
+        struct Frame {
+            uint32_t node;
+            int offset;  // pending offsets of all ancestors
+        };
+
+        const std::vector<Node>* pool;
+        std::vector<Frame> stack;
+
+        explicit const_iterator(const std::vector<Node>& nodes) : pool(&nodes) {}
+
+        const_iterator(const std::vector<Node>& nodes, const uint32_t root, const int* from) : pool(&nodes) {
+            descend(root, 0, from);
+        }
+
+        // Positions on the entry `rank` places into the subtree at `t`,
+        // stacking the ancestors still to be visited on the way down
+        void seek(uint32_t t, size_t rank) {
+            int offset = 0;
+            while (t != NIL) {
+                const Node& n = (*pool)[t];
+                const size_t left = n.left == NIL ? 0 : (*pool)[n.left].size;
+                if (rank < left) {
+                    stack.push_back(Frame{t, offset});
+                    t = n.left;
+                } else if (rank == left) {
+                    stack.push_back(Frame{t, offset});
+                    return;
+                } else {
+                    rank -= left + 1;
+                    t = n.right;
+                }
+                offset += n.lazy;
+            }
+        }
+
+        // Pushes the left spine of `t`, skipping keys below `*from` if given
+        void descend(uint32_t t, int offset, const int* from) {
+            while (t != NIL) {
+                const Node& n = (*pool)[t];
+                if (from && n.key + offset < *from) {
+                    offset += n.lazy;
+                    t = n.right;
+                    continue;
+                }
+                stack.push_back(Frame{t, offset});
+                offset += n.lazy;
+                t = n.left;
+            }
+        }
+    };
+};
+
+#endif
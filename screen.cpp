@@ -0,0 +1,121 @@
+#include "screen.h"
+#include "colors.h"
+#include "output.h"
+#include "stats.h"
+#include <cstdlib>
+
+#ifndef _WIN32
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+#endif
+
+#define CLEAR_SEQUENCE "\033[H\033[2J\033[3J"
+#define CLEAR_LINE "\033[K"
+#define CLEAR_BELOW "\033[J"
+
+// Rows kept free under a frame for answers and messages. A frame that does
+// not leave this many may have scrolled, so it is repainted whole.
+#define FRAME_SLACK 8
+
+// Fewest rows room() hands out, even on a terminal too short to redraw in place
+#define MIN_ROOM 3
+
+Screen::Screen() : allocations_seen(0) {
+    #ifdef _WIN32
+        terminal = false;
+    #else
+        terminal = isatty(STDOUT_FILENO) != 0;
+    #endif
+}
+
+void Screen::clear() {
+    #ifdef _WIN32
+        system("cls");
+    #else
+        output::print(CLEAR_SEQUENCE);
+        output::flush();
+    #endif
+}
+
+int Screen::rows() {
+    #ifndef _WIN32
+        winsize size{};
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0) return size.ws_row;
+    #endif
+    return 24;
+}
+
+size_t Screen::room(const size_t used) {
+    const size_t limit = static_cast<size_t>(rows());
+    return used + FRAME_SLACK + MIN_ROOM < limit ? limit - used - FRAME_SLACK : MIN_ROOM;
+}
+
+// Splits a frame into lines, each prefixed with the colors still in effect
+// from the lines above it, so any one line can be redrawn on its own
+void Screen::split(const std::string& frame, std::vector<std::string>& lines) {
+    lines.clear();
+    std::string style;
+    size_t start = 0;
+
+    while (true) {
+        const size_t newline = frame.find('\n', start);
+        const size_t stop = newline == std::string::npos ? frame.size() : newline;
+
+        lines.push_back(RESET + style);
+        lines.back().append(frame, start, stop - start);
+
+        for (size_t i = frame.find("\033[", start); i < stop; i = frame.find("\033[", i)) {
+            const size_t end = frame.find('m', i);
+            if (end >= stop) break;
+            if (end == i + 2 || frame.compare(i, end - i + 1, RESET) == 0) style.clear();
+            else style.append(frame, i, end - i + 1);
+            i = end + 1;
+        }
+
+        if (newline == std::string::npos) break;
+        start = newline + 1;
+    }
+}
+
+void Screen::present(const std::string& frame) {
+    STATS_TIMER(FRAME_US);
+    std::vector<std::string> lines;
+    split(frame, lines);
+
+    // Whatever was printed under the last frame goes out with this one, in
+    // the same write
+    const size_t before = output::pending();
+    const size_t limit = static_cast<size_t>(rows());
+    if (!terminal || shown.empty() || lines.size() + FRAME_SLACK > limit || shown.size() + FRAME_SLACK > limit) {
+        #ifdef _WIN32
+            clear();
+            output::print(frame);
+        #else
+            output::print(CLEAR_SEQUENCE, frame);
+        #endif
+    } else {
+        // The old prompt line holds whatever was typed at it, so it is always
+        // redrawn; the prompt itself goes last to leave the cursor after it
+        const size_t prompt = lines.size() - 1;
+        for (size_t i = 0; i < prompt; i++) {
+            if (i < shown.size() && lines[i] == shown[i] && i != shown.size() - 1) continue;
+            output::print("\033[", i + 1, ";1H", lines[i], CLEAR_LINE);
+        }
+        output::print("\033[", prompt + 1, ";1H", lines[prompt], CLEAR_BELOW);
+    }
+
+    counted(output::pending() - before);
+    output::flush();
+    shown.swap(lines);
+}
+
+void Screen::counted(const size_t bytes) {
+    #ifdef TODO_BBS_STATS
+        STATS_RECORD(FRAME_BYTES, bytes);
+        const uint64_t allocations = stats::allocations();
+        STATS_RECORD(FRAME_ALLOCS, allocations - allocations_seen);
+        allocations_seen = allocations;
+    #else
+        (void)bytes;
+    #endif
+}
@@ -0,0 +1,43 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Draws whole-screen frames on an ANSI terminal. The last frame drawn is
+// kept, so the next one only rewrites the lines that differ from it.
+//
+// A frame's last line is its prompt: the cursor is left at the end of it,
+// and anything printed after present() (typed answers, messages) is wiped
+// by the next frame. Output that is not a terminal gets every frame whole.
+class Screen {
+public:
+    Screen();
+
+    void present(const std::string& frame);
+
+    // The terminal no longer shows the last frame; the next one is drawn whole
+    void invalidate() { shown.clear(); }
+
+    // Clears the terminal and homes the cursor
+    static void clear();
+
+    // Terminal height (TIOCGWINSZ), or 24 when it cannot be told
+    static int rows();
+
+    // Rows a frame that already uses `used` can still fill and be redrawn
+    // in place; never fewer than a handful
+    static size_t room(size_t used);
+
+private:
+    std::vector<std::string> shown;  // last frame, one styled line per entry
+    bool terminal;
+    uint64_t allocations_seen;  // by the last frame (see stats.h)
+
+    static void split(const std::string& frame, std::vector<std::string>& lines);
+    // Records the bytes written for a frame, and the allocations since the last
+    void counted(size_t bytes);
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "search_index.h"
+#include <algorithm>
+
+static unsigned char fold(const char c) {
+    const unsigned char u = static_cast<unsigned char>(c);
+    return u >= 'A' && u <= 'Z' ? static_cast<unsigned char>(u + ('a' - 'A')) : u;
+}
+
+static uint32_t trigram_at(const char* p) {
+    return static_cast<uint32_t>(fold(p[0])) << 16 | static_cast<uint32_t>(fold(p[1])) << 8 | fold(p[2]);
+}
+
+const TodoStore::ItemId SearchIndex::DEAD;
+
+// Orders posting entries by id, dead or not
+bool SearchIndex::id_less(const TodoStore::ItemId entry, const TodoStore::ItemId id) {
+    return (entry & ~DEAD) < id;
+}
+
+void SearchIndex::build() {
+    reset();
+    built = true;
+
+    // In id order, so every posting list is built by appending
+    std::vector<TodoStore::ItemId> ids;
+    ids.reserve(store.priority_items().size() + store.regular_items().size());
+    for (const auto& entry : store.priority_items()) ids.push_back(entry.second);
+    ids.insert(ids.end(), store.regular_items().begin(), store.regular_items().end());
+    std::sort(ids.begin(), ids.end());
+    for (const TodoStore::ItemId id : ids) add(id);
+}
+
+void SearchIndex::reset() {
+    postings.clear();
+    live_postings = 0;
+    dead_postings = 0;
+    built = false;
+}
+
+// Distinct trigrams of one description, into `scratch`
+void SearchIndex::trigrams(const TodoStore::ItemId id) {
+    const char* desc = store.description_data(id);
+    const size_t length = store.description_size(id);
+
+    scratch.clear();
+    for (size_t i = 0; i + 3 <= length; i++) scratch.push_back(trigram_at(desc + i));
+    std::sort(scratch.begin(), scratch.end());
+    scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+}
+
+void SearchIndex::add(const TodoStore::ItemId id) {
+    if (!built) return;
+    trigrams(id);
+    for (const uint32_t trigram : scratch) {
+        std::vector<TodoStore::ItemId>& list = postings[trigram];
+        live_postings++;
+        if (list.empty() || (list.back() & ~DEAD) < id) {
+            list.push_back(id);
+            continue;
+        }
+
+        // A reused id: revive its old entry, or take over a dead neighbour,
+        // before shifting the list to make room
+        const auto pos = std::lower_bound(list.begin(), list.end(), id, id_less);
+        if ((*pos & ~DEAD) == id) {
+            if (*pos & DEAD) dead_postings--;
+            else live_postings--;  // already there
+            *pos = id;
+        } else if (*pos & DEAD) {
+            dead_postings--;
+            *pos = id;
+        } else if (pos != list.begin() && (*(pos - 1) & DEAD)) {
+            dead_postings--;
+            *(pos - 1) = id;
+        } else {
+            list.insert(pos, id);
+        }
+    }
+}
+
+void SearchIndex::remove(const TodoStore::ItemId id) {
+    if (!built) return;
+    trigrams(id);
+    for (const uint32_t trigram : scratch) {
+        const auto found = postings.find(trigram);
+        if (found == postings.end()) continue;
+
+        std::vector<TodoStore::ItemId>& list = found->second;
+        const auto pos = std::lower_bound(list.begin(), list.end(), id, id_less);
+        if (pos == list.end() || *pos != id) continue;
+        *pos |= DEAD;
+        live_postings--;
+        dead_postings++;
+    }
+    if (dead_postings > live_postings) sweep();
+}
+
+// Drops the dead entries, in one pass over every list
+void SearchIndex::sweep() {
+    for (auto it = postings.begin(); it != postings.end();) {
+        std::vector<TodoStore::ItemId>& list = it->second;
+        list.erase(std::remove_if(list.begin(), list.end(), [](const TodoStore::ItemId entry) { return (entry & DEAD) != 0; }),
+                   list.end());
+        if (list.empty()) it = postings.erase(it);
+        else ++it;
+    }
+    dead_postings = 0;
+}
+
+bool SearchIndex::matches(const TodoStore::ItemId id, const std::string& needle, const bool prefix) const {
+    const char* desc = store.description_data(id);
+    const size_t length = store.description_size(id);
+    if (length < needle.size()) return false;
+
+    const size_t last = prefix ? 0 : length - needle.size();
+    for (size_t i = 0; i <= last; i++) {
+        size_t j = 0;
+        while (j < needle.size() && fold(desc[i + j]) == static_cast<unsigned char>(needle[j])) j++;
+        if (j == needle.size()) return true;
+    }
+    return false;
+}
+
+size_t SearchIndex::find(const std::string& query, std::vector<TodoStore::ItemId>& out, const size_t limit) const {
+    const bool prefix = !query.empty() && query[0] == '^';
+    std::string needle = query.substr(prefix ? 1 : 0);
+    if (needle.empty() || limit == 0) return 0;
+    for (char& c : needle) c = static_cast<char>(fold(c));
+
+    size_t found = 0;
+    auto consider = [&](const TodoStore::ItemId id) {
+        if (!matches(id, needle, prefix)) return true;
+        out.push_back(id);
+        return ++found < limit;
+    };
+
+    if (needle.size() < 3 || !built) {
+        for (const auto& entry : store.priority_items()) {
+            if (!consider(entry.second)) return found;
+        }
+        for (const TodoStore::ItemId id : store.regular_items()) {
+            if (!consider(id)) return found;
+        }
+        return found;
+    }
+
+    // Every match holds every trigram of the needle, so the rarest one's
+    // list already covers all of them
+    const std::vector<TodoStore::ItemId>* candidates = nullptr;
+    for (size_t i = 0; i + 3 <= needle.size(); i++) {
+        const auto list = postings.find(trigram_at(needle.data() + i));
+        if (list == postings.end()) return 0;
+        if (!candidates || list->second.size() < candidates->size()) candidates = &list->second;
+    }
+
+    for (const TodoStore::ItemId id : *candidates) {
+        if (id & DEAD) continue;
+        if (!consider(id)) break;
+    }
+    return found;
+}
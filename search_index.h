@@ -0,0 +1,58 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "todo_store.h"
+
+// Trigram index over every description in a TodoStore, both lists.
+// Each distinct 3-byte sequence (ASCII case folded) maps to the items that
+// contain it. A query looks up its rarest trigram and checks only those
+// items, so the cost follows the number of candidates, not the list size.
+class SearchIndex {
+public:
+    explicit SearchIndex(const TodoStore& store)
+        : store(store), live_postings(0), dead_postings(0), built(false) {}
+
+    // Indexes every live item. Until then the index is empty and unused.
+    void build();
+    bool is_built() const { return built; }
+    // Forgets everything, e.g. after the store was reloaded
+    void reset();
+
+    // Keep the index in step with the store: add after the item is added,
+    // remove while its description is still there
+    void add(TodoStore::ItemId id);
+    void remove(TodoStore::ItemId id);
+
+    // Live items whose description contains `query`, ignoring ASCII case;
+    // a leading '^' matches only at the start. Appends at most `limit` ids to
+    // `out`, in no particular order, and returns how many it appended.
+    // Queries under three bytes have no trigram and scan every item.
+    size_t find(const std::string& query, std::vector<TodoStore::ItemId>& out, size_t limit) const;
+
+private:
+    const TodoStore& store;
+    // Posting lists are sorted by id. A removed item's entries are only
+    // flagged with DEAD, which keeps the order, so removing is a binary
+    // search per trigram rather than a shift of the whole list. Re-adding
+    // the id (the store reuses them) revives its entries in place; the
+    // rest are swept out once they outnumber the live ones.
+    static const TodoStore::ItemId DEAD = 0x80000000u;
+
+    std::unordered_map<uint32_t, std::vector<TodoStore::ItemId>> postings;
+    std::vector<uint32_t> scratch;  // trigrams of the item being (un)indexed
+    size_t live_postings;
+    size_t dead_postings;
+    bool built;
+
+    static bool id_less(TodoStore::ItemId entry, TodoStore::ItemId id);
+    void sweep();
+
+    void trigrams(TodoStore::ItemId id);
+    bool matches(TodoStore::ItemId id, const std::string& needle, bool prefix) const;
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include "stats.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+// Bucket i holds values in [2^(i-1), 2^i - 1]; bucket 0 holds zeros
+#define BUCKETS 48
+
+namespace {
+    // All zeros is empty, so these are ready before any constructor runs,
+    // operator new included. The smallest value is kept inverted, so it can
+    // be raised like the largest.
+    struct Histogram {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> inverted_min;
+        std::atomic<uint64_t> max;
+        std::atomic<uint64_t> buckets[BUCKETS];
+    };
+
+    Histogram histograms[stats::METRIC_COUNT];
+    std::atomic<uint64_t> allocation_count;
+
+    // As written to the JSON dump, and as shown on the statistics screen
+    const char* const names[stats::METRIC_COUNT] = {
+        "load_us", "render_us", "frame_us", "frame_bytes", "frame_allocs", "commit_us", "commit_bytes", "fold_us"
+    };
+    const char* const labels[stats::METRIC_COUNT] = {
+        "load", "render", "frame", "frame size", "frame allocs", "commit", "commit size", "fold"
+    };
+
+    void raise_to(std::atomic<uint64_t>& slot, const uint64_t value) {
+        uint64_t seen = slot.load(std::memory_order_relaxed);
+        while (value > seen && !slot.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+    }
+
+    size_t bucket_of(uint64_t value) {
+        size_t bucket = 0;
+        while (value) {
+            value >>= 1;
+            bucket++;
+        }
+        return bucket < BUCKETS ? bucket : BUCKETS - 1;
+    }
+
+    uint64_t bucket_top(const size_t bucket) {
+        return bucket == 0 ? 0 : (uint64_t(1) << bucket) - 1;
+    }
+
+    // Upper bound of the bucket holding the `share` quantile, capped at the max
+    uint64_t quantile(const Histogram& h, const double share) {
+        const uint64_t count = h.count.load(std::memory_order_relaxed);
+        const uint64_t wanted = static_cast<uint64_t>(static_cast<double>(count) * share + 0.5);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            seen += h.buckets[i].load(std::memory_order_relaxed);
+            if (seen >= wanted && seen > 0) {
+                const uint64_t top = bucket_top(i);
+                const uint64_t max = h.max.load(std::memory_order_relaxed);
+                return top < max ? top : max;
+            }
+        }
+        return h.max.load(std::memory_order_relaxed);
+    }
+
+    bool is_time(const stats::Metric metric) {
+        return metric == stats::LOAD_US || metric == stats::RENDER_US || metric == stats::FRAME_US
+               || metric == stats::COMMIT_US || metric == stats::FOLD_US;
+    }
+
+    bool is_size(const stats::Metric metric) {
+        return metric == stats::FRAME_BYTES || metric == stats::COMMIT_BYTES;
+    }
+
+    std::string format(const stats::Metric metric, const uint64_t value) {
+        char text[32];
+        if (is_time(metric) && value >= 1000) {
+            std::snprintf(text, sizeof(text), "%.1f ms", static_cast<double>(value) / 1000);
+        } else if (is_time(metric)) {
+            std::snprintf(text, sizeof(text), "%llu us", static_cast<unsigned long long>(value));
+        } else if (is_size(metric) && value >= 1024 * 1024) {
+            std::snprintf(text, sizeof(text), "%.1f MiB", static_cast<double>(value) / (1024 * 1024));
+        } else if (is_size(metric) && value >= 1024) {
+            std::snprintf(text, sizeof(text), "%.1f KiB", static_cast<double>(value) / 1024);
+        } else if (is_size(metric)) {
+            std::snprintf(text, sizeof(text), "%llu B", static_cast<unsigned long long>(value));
+        } else {
+            std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(value));
+        }
+        return text;
+    }
+
+    // The value of TODO_BBS_STATS, or null when it is unset or "0"
+    const char* setting() {
+        const char* value = std::getenv("TODO_BBS_STATS");
+        return value && *value && std::string(value) != "0" ? value : nullptr;
+    }
+}
+
+bool stats::compiled() {
+    #ifdef TODO_BBS_STATS
+        return true;
+    #else
+        return false;
+    #endif
+}
+
+bool stats::enabled() {
+    static const bool on = compiled() && setting() != nullptr;
+    return on;
+}
+
+void stats::record(const Metric metric, const uint64_t value) {
+    Histogram& h = histograms[metric];
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.sum.fetch_add(value, std::memory_order_relaxed);
+    raise_to(h.max, value);
+    raise_to(h.inverted_min, ~value);
+    h.buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t stats::allocations() {
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+std::string stats::summary() {
+    // Columns padded alike, so a box centring the lines keeps them aligned
+    std::string text;
+    char line[160];
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        const Metric metric = static_cast<Metric>(m);
+        const Histogram& h = histograms[m];
+        const uint64_t count = h.count.load(std::memory_order_relaxed);
+        if (count == 0) continue;
+
+        std::snprintf(line, sizeof(line), "%-13s %7llux  mean %-9s  p50 %-9s  p99 %-9s  max %-9s\n", labels[m],
+                      static_cast<unsigned long long>(count),
+                      format(metric, h.sum.load(std::memory_order_relaxed) / count).c_str(),
+                      format(metric, quantile(h, 0.5)).c_str(), format(metric, quantile(h, 0.99)).c_str(),
+                      format(metric, h.max.load(std::memory_order_relaxed)).c_str());
+        text += line;
+    }
+    if (text.empty()) return "nothing recorded yet\n";
+
+    std::snprintf(line, sizeof(line), "%-13s %7llu  %-60s\n", "allocations",
+                  static_cast<unsigned long long>(allocations()), "in all");
+    return text + line;
+}
+
+bool stats::dump() {
+    const char* path = setting();
+    if (!enabled() || std::string(path) == "1") return true;
+
+    std::ofstream out(path);
+    out << "{\"allocations\": " << allocations() << ", \"metrics\": {";
+    bool first = true;
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        const Histogram& h = histograms[m];
+        const uint64_t count = h.count.load(std::memory_order_relaxed);
+        if (count == 0) continue;
+
+        out << (first ? "\n" : ",\n") << "  \"" << names[m] << "\": {\"count\": " << count
+            << ", \"sum\": " << h.sum.load(std::memory_order_relaxed)
+            << ", \"min\": " << ~h.inverted_min.load(std::memory_order_relaxed)
+            << ", \"max\": " << h.max.load(std::memory_order_relaxed)
+            << ", \"p50\": " << quantile(h, 0.5) << ", \"p90\": " << quantile(h, 0.9)
+            << ", \"p99\": " << quantile(h, 0.99) << ", \"buckets\": [";
+        bool first_bucket = true;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            const uint64_t in_bucket = h.buckets[i].load(std::memory_order_relaxed);
+            if (in_bucket == 0) continue;
+            out << (first_bucket ? "" : ", ") << "[" << bucket_top(i) << ", " << in_bucket << "]";
+            first_bucket = false;
+        }
+        out << "]}";
+        first = false;
+    }
+    out << "\n}}\n";
+    return static_cast<bool>(out.flush());
+}
+
+#ifdef TODO_BBS_STATS
+// Counts every heap allocation; cheaper than the allocation itself
+void* operator new(const std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](const std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+// The sized forms, which C++14 calls when the size is known
+void operator delete(void* memory, std::size_t) noexcept {
+    operator delete(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    operator delete[](memory);
+}
+#endif
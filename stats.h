@@ -0,0 +1,78 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Timings and sizes from the hot paths, kept as histograms for the hidden
+// statistics screen and a JSON dump on exit. Compiled in only when built
+// with TODO_BBS_STATS (the CMake option of that name, or `make STATS=1`),
+// and even then recorded only while the TODO_BBS_STATS environment variable
+// is set. Recording is a few relaxed atomic adds, so the saver and
+// compactor threads record too.
+class stats {
+public:
+    enum Metric {
+        LOAD_US,       // reading the lists and replaying the journal
+        RENDER_US,     // formatting one list window (cache misses only)
+        FRAME_US,      // diffing and writing one frame to the terminal
+        FRAME_BYTES,   // bytes written for one frame
+        FRAME_ALLOCS,  // heap allocations between two frames
+        COMMIT_US,     // one commit or background save, lock to flush
+        COMMIT_BYTES,  // journal bytes appended by it
+        FOLD_US,       // rewriting the list files from the journal
+        METRIC_COUNT
+    };
+
+    // Whether this build records anything at all
+    static bool compiled();
+    // Whether it is recording now: compiled in and asked for
+    static bool enabled();
+
+    static void record(Metric metric, uint64_t value);
+    // Heap allocations so far (0 unless compiled in)
+    static uint64_t allocations();
+
+    // One line per metric that has values, for the statistics screen
+    static std::string summary();
+    // Writes the histograms if TODO_BBS_STATS names a file; returns false
+    // only if writing it failed
+    static bool dump();
+};
+
+// Records the microseconds from construction to destruction
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const stats::Metric metric) : metric(metric), running(stats::enabled()) {
+        if (running) start = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (!running) return;
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        stats::record(metric, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    stats::Metric metric;
+    bool running;
+    std::chrono::steady_clock::time_point start;
+};
+
+// What the hot paths call; nothing at all unless compiled in
+#ifdef TODO_BBS_STATS
+    #define STATS_CONCAT_(a, b) a##b
+    #define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+    #define STATS_TIMER(metric) ScopedTimer STATS_CONCAT(stats_timer_, __LINE__)(stats::metric)
+    #define STATS_RECORD(metric, value) \
+        do { if (stats::enabled()) stats::record(stats::metric, static_cast<uint64_t>(value)); } while (0)
+#else
+    #define STATS_TIMER(metric) ((void)0)
+    #define STATS_RECORD(metric, value) ((void)0)
+#endif
+
+#endif
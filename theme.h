@@ -0,0 +1,77 @@
+#ifndef THEME_H
+#define THEME_H
+
+#include <cstddef>
+#include <string_view>
+#include "colors.h"
+
+// Text laid out at compile time in a buffer of its own, so using it costs
+// one append of a constant and no string is ever built for it
+template <size_t N>
+struct FixedText {
+    char text[N + 1];
+
+    constexpr FixedText() : text{} {}
+    constexpr size_t size() const { return N; }
+    constexpr const char* data() const { return text; }
+    constexpr operator std::string_view() const { return std::string_view(text, N); }
+};
+
+// A string literal as FixedText
+template <size_t Bytes>
+constexpr FixedText<Bytes - 1> literal(const char (&from)[Bytes]) {
+    FixedText<Bytes - 1> out;
+    for (size_t i = 0; i < Bytes - 1; i++) out.text[i] = from[i];
+    return out;
+}
+
+// `Count` copies of `glyph`, which may take several bytes ("═" takes 3)
+template <size_t Count, size_t Bytes>
+constexpr FixedText<Count * (Bytes - 1)> repeat(const char (&glyph)[Bytes]) {
+    FixedText<Count * (Bytes - 1)> out;
+    for (size_t i = 0; i < Count * (Bytes - 1); i++) out.text[i] = glyph[i % (Bytes - 1)];
+    return out;
+}
+
+template <size_t Count>
+constexpr FixedText<Count> repeat(const char glyph) {
+    FixedText<Count> out;
+    for (size_t i = 0; i < Count; i++) out.text[i] = glyph;
+    return out;
+}
+
+template <size_t Total, size_t N>
+constexpr void append_text(FixedText<Total>& out, size_t& at, const FixedText<N>& part) {
+    for (size_t i = 0; i < N; i++) out.text[at++] = part.text[i];
+}
+
+// The parts one after another
+template <size_t... N>
+constexpr FixedText<(N + ... + 0)> join(const FixedText<N>&... parts) {
+    FixedText<(N + ... + 0)> out;
+    size_t at = 0;
+    (append_text(out, at, parts), ...);
+    return out;
+}
+
+// Width of the rules between menu sections
+#define RULE_WIDTH 72
+
+// A color set for the screens, which take it as a template parameter. The
+// colors are literals, so everything made from them below is laid out at
+// compile time; a theme is a struct with these same members.
+struct RetroTheme {
+    static constexpr char text[] = CYAN;          // box contents and menus
+    static constexpr char banner[] = CYAN BOLD;   // the title box
+    static constexpr char priority[] = MAGENTA BOLD;
+    static constexpr char regular[] = GREEN BOLD;
+    static constexpr char panel[] = YELLOW BOLD;  // search, list and statistics boxes
+    static constexpr char rule[] = BLUE;
+};
+
+// A full-width rule of `Glyph` in the theme's rule color, newline included
+template <class Theme, char Glyph>
+constexpr auto rule_line = join(literal(Theme::rule), repeat<RULE_WIDTH>(Glyph),
+                                literal(RESET "\n"));
+
+#endif
@@ -0,0 +1,385 @@
+#include "todo_file.h"
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <limits>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <direct.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define TODO_HAVE_SSE2 1
+// AVX2 is picked at run time, so it needs only the intrinsics above
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TODO_HAVE_AVX2 1
+#endif
+#endif
+
+MappedFile::MappedFile(const std::string& filename, const bool sequential)
+    : bytes(nullptr), length(0), opened(false), mapped(false) {
+#ifndef _WIN32
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0) {
+        opened = true;
+        length = static_cast<size_t>(st.st_size);
+        if (length > 0) {
+            void* addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                madvise(addr, length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+                bytes = static_cast<const char*>(addr);
+                mapped = true;
+            } else {
+                length = 0;
+                opened = false;
+            }
+        }
+    }
+    close(fd);
+    if (mapped || !opened) return;
+#endif
+
+    // No mmap (Windows) or an empty file: read it the portable way
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return;
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    fallback = contents.str();
+    bytes = fallback.data();
+    length = fallback.size();
+    opened = true;
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped) munmap(const_cast<char*>(bytes), length);
+#endif
+}
+
+FileLock::FileLock(const std::string& path, const bool wait) : fd(-1), locked(false) {
+#ifndef _WIN32
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return;
+    int result;
+    do {
+        result = flock(fd, LOCK_EX | (wait ? 0 : LOCK_NB));
+    } while (result != 0 && errno == EINTR);
+    locked = result == 0;
+#else
+    (void)path;
+    (void)wait;
+    locked = true;
+#endif
+}
+
+FileLock::~FileLock() {
+#ifndef _WIN32
+    // Closing the descriptor drops the lock
+    if (fd >= 0) close(fd);
+#endif
+}
+
+// Helper scanners used by todofile::find
+static const char* find_scalar(const char* p, const char* end, const char c) {
+    while (p < end && *p != c) ++p;
+    return p;
+}
+
+#ifdef TODO_HAVE_SSE2
+static const char* find_sse2(const char* p, const char* end, const char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+    return find_scalar(p, end, c);
+}
+#endif
+
+#ifdef TODO_HAVE_AVX2
+__attribute__((target("avx2")))
+static const char* find_avx2(const char* p, const char* end, const char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return find_scalar(p, end, c);
+}
+#endif
+
+typedef const char* (*FindFn)(const char*, const char*, char);
+
+static FindFn select_find() {
+#ifdef TODO_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return find_avx2;
+#endif
+#ifdef TODO_HAVE_SSE2
+    return find_sse2;
+#else
+    return find_scalar;
+#endif
+}
+
+const char* todofile::find(const char* begin, const char* end, const char c) {
+    static const FindFn impl = select_find();
+    return impl(begin, end, c);
+}
+
+bool todofile::parse_priority(const char* p, const char* end, int& priority) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    if (p == end || *p < '0' || *p > '9') return false;
+
+    // One more below zero than above, so INT_MIN reads back as itself
+    const long long limit = std::numeric_limits<int>::max() + (negative ? 1LL : 0LL);
+    long long value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        if (value > limit) return false;
+        ++p;
+    }
+
+    priority = static_cast<int>(negative ? -value : value);
+    return true;
+}
+
+bool todofile::load(const std::string& filename, TodoStore& store, const bool is_priority) {
+    const MappedFile file(filename);
+    if (!file.is_open()) return false;
+
+    const char* p = file.data();
+    const char* const end = p + file.size();
+
+    // One arena reservation covers every description in the file
+    store.reserve(0, file.size());
+    std::vector<std::pair<int, TodoStore::ItemId>> entries;
+
+    while (p < end) {
+        const char* eol = find(p, end, '\n');
+
+        if (eol != p) {
+            if (is_priority) {
+                const char* bar = find(p, eol, '|');
+                int pri;
+                if (bar != eol && parse_priority(p, bar, pri)) {
+                    const TodoStore::ItemId id = store.add_text(bar + 1, static_cast<size_t>(eol - bar - 1),
+                                                                TodoStore::LIVE | TodoStore::PRIORITY);
+                    entries.emplace_back(pri, id);
+                }
+            } else {
+                store.append_regular(store.add_text(p, static_cast<size_t>(eol - p), TodoStore::LIVE));
+            }
+        }
+
+        p = eol == end ? end : eol + 1;
+    }
+
+    if (is_priority) store.assign_priorities(entries);
+    return true;
+}
+
+void todofile::format(const TodoStore& store, const bool is_priority, std::string& out) {
+    if (is_priority) {
+        for (const auto& entry : store.priority_items()) {
+            out += std::to_string(entry.first);
+            out += '|';
+            out.append(store.description_data(entry.second), store.description_size(entry.second));
+            out += '\n';
+        }
+    } else {
+        for (const TodoStore::ItemId id : store.regular_items()) {
+            out.append(store.description_data(id), store.description_size(id));
+            out += '\n';
+        }
+    }
+}
+
+#ifndef _WIN32
+bool todofile::write_all(const int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+#endif
+
+// Writes all of `contents` and forces it to disk
+static bool write_synced(const std::string& path, const std::string& contents) {
+#ifndef _WIN32
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    if (!todofile::write_all(fd, contents.data(), contents.size())) {
+        close(fd);
+        return false;
+    }
+
+    const bool synced = fsync(fd) == 0;
+    return close(fd) == 0 && synced;
+#else
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const bool written = std::fwrite(contents.data(), 1, contents.size(), f) == contents.size();
+    return std::fclose(f) == 0 && written;
+#endif
+}
+
+// Makes completed renames in the directory holding `path` durable
+static void sync_directory(const std::string& path) {
+#ifndef _WIN32
+    const size_t slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    const int fd = open(dir.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+#else
+    (void)path;
+#endif
+}
+
+static bool rename_into_place(const std::string& path) {
+    const std::string temp = path + ".tmp";
+#ifdef _WIN32
+    std::remove(path.c_str());  // rename does not replace on Windows
+#endif
+    return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+bool todofile::write_temp(const std::string& path, const std::string& contents) {
+    return write_synced(path + ".tmp", contents);
+}
+
+bool todofile::switch_over(const std::string& intent, const std::vector<std::string>& paths) {
+    // The trailing "end" marks the intent complete; a torn intent is ignored
+    std::string record;
+    for (const auto& path : paths) record += path + "\n";
+    record += "end\n";
+    if (!write_synced(intent, record)) return false;
+    sync_directory(intent);
+
+    bool ok = true;
+    for (const auto& path : paths) ok = rename_into_place(path) && ok;
+    sync_directory(paths.empty() ? intent : paths.front());
+
+    std::remove(intent.c_str());
+    return ok;
+}
+
+void todofile::recover(const std::string& intent) {
+    std::vector<std::string> paths;
+    bool complete = false;
+    {
+        const MappedFile file(intent);
+        if (!file.is_open()) return;
+
+        const char* p = file.data();
+        const char* const end = p + file.size();
+        while (p < end) {
+            const char* eol = find(p, end, '\n');
+            if (eol == end) break;
+            const std::string line(p, eol);
+            if (line == "end") {
+                complete = true;
+                break;
+            }
+            paths.push_back(line);
+            p = eol + 1;
+        }
+    }
+
+    // Every temp was synced before the intent was written, so a complete
+    // intent can always be rolled forward
+    if (complete) {
+        for (const auto& path : paths) rename_into_place(path);
+        sync_directory(intent);
+    }
+    std::remove(intent.c_str());
+}
+
+std::string todofile::sibling(const std::string& file, const std::string& name) {
+    const size_t slash = file.find_last_of("/\\");
+    const std::string dir = slash == std::string::npos ? "" : file.substr(0, slash + 1);
+    return dir + name;
+}
+
+bool todofile::exists(const std::string& path) {
+    std::ifstream file(path);
+    return file.is_open();
+}
+
+bool todofile::is_directory(const std::string& path) {
+    struct stat st{};
+    return !path.empty() && stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFMT) == S_IFDIR;
+}
+
+bool todofile::make_directory(const std::string& path) {
+#ifndef _WIN32
+    if (mkdir(path.c_str(), 0755) == 0) return true;
+#else
+    if (_mkdir(path.c_str()) == 0) return true;
+#endif
+    return is_directory(path);
+}
+
+std::vector<std::string> todofile::directories(const std::string& path) {
+    std::vector<std::string> names;
+#ifndef _WIN32
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return names;
+    while (const dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        if (is_directory(path + "/" + entry->d_name)) names.push_back(entry->d_name);
+    }
+    closedir(dir);
+#else
+    (void)path;
+#endif
+    return names;
+}
+
+FileStamp todofile::stamp(const std::string& path) {
+    FileStamp result{false, 0, 0, 0, 0};
+    struct stat st{};
+    if (path.empty() || stat(path.c_str(), &st) != 0) return result;
+
+    result.exists = true;
+    result.device = static_cast<unsigned long long>(st.st_dev);
+    result.inode = static_cast<unsigned long long>(st.st_ino);
+    result.size = static_cast<unsigned long long>(st.st_size);
+#ifndef _WIN32
+    result.mtime_ns = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#else
+    result.mtime_ns = static_cast<long long>(st.st_mtime) * 1000000000LL;
+#endif
+    return result;
+}
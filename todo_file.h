@@ -0,0 +1,111 @@
+#ifndef TODO_FILE_H
+#define TODO_FILE_H
+
+#include <string>
+#include <vector>
+#include "todo_store.h"
+
+// Read-only view of a whole file. Uses mmap where available so loading a
+// list never copies the raw bytes into a stream buffer first.
+class MappedFile {
+public:
+    // `sequential` hints a single front-to-back pass; pass false when the
+    // bytes are read on demand
+    explicit MappedFile(const std::string& filename, bool sequential = true);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_open() const { return opened; }
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char* bytes;
+    size_t length;
+    bool opened;
+    bool mapped;
+    std::string fallback;  // holds the contents when mmap is unavailable
+};
+
+// Advisory lock on a file (created if missing), held until destruction.
+// flock(2) on POSIX, so it only excludes processes that take the same lock;
+// on Windows it is a no-op and always reports success.
+class FileLock {
+public:
+    // With `wait` false, gives up at once if another process holds it
+    explicit FileLock(const std::string& path, bool wait = true);
+    ~FileLock();
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+    bool is_locked() const { return locked; }
+
+private:
+    int fd;
+    bool locked;
+};
+
+// What stat() says about a file, enough to tell whether it was rewritten
+// (new inode) or appended to (new size or mtime) since it was last looked at
+struct FileStamp {
+    bool exists;
+    unsigned long long device;
+    unsigned long long inode;
+    unsigned long long size;
+    long long mtime_ns;
+
+    bool operator==(const FileStamp& other) const {
+        return exists == other.exists && device == other.device && inode == other.inode
+               && size == other.size && mtime_ns == other.mtime_ns;
+    }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+class todofile {
+public:
+    // First occurrence of `c` in [begin, end), or `end`. Vectorized (AVX2 or
+    // SSE2, picked at runtime) with a scalar fallback.
+    static const char* find(const char* begin, const char* end, char c);
+
+    // Parses the "<priority>" part of a priority line the way std::stoi would
+    // (leading blanks, optional sign), without building a temporary string.
+    static bool parse_priority(const char* begin, const char* end, int& priority);
+
+    // Appends every non-empty line of `filename` to the store's priority or
+    // regular list. Descriptions are copied straight from the mapping into
+    // the store's arena. Returns false if the file could not be opened.
+    static bool load(const std::string& filename, TodoStore& store, bool is_priority);
+
+    // Renders one list in the text format into `out`
+    static void format(const TodoStore& store, bool is_priority, std::string& out);
+
+    // Crash-safe replacement of a group of files:
+    //   1. write_temp() each new file as "<path>.tmp" (one write + fsync)
+    //   2. switch_over() records the group in an intent file, renames every
+    //      temp into place and then deletes the intent
+    // If we die part way through step 2, recover() finishes the renames on
+    // the next start, so the group always switches over as a whole.
+    static bool write_temp(const std::string& path, const std::string& contents);
+#ifndef _WIN32
+    // Writes all `size` bytes to `fd`, going on after short writes and
+    // writes cut short by a signal (EINTR)
+    static bool write_all(int fd, const char* data, size_t size);
+#endif
+    static bool switch_over(const std::string& intent, const std::vector<std::string>& paths);
+    static void recover(const std::string& intent);
+
+    // A file named `name` in the same directory as `file`
+    static std::string sibling(const std::string& file, const std::string& name);
+    static bool exists(const std::string& path);
+    static bool is_directory(const std::string& path);
+    // Creates one directory; true if it is there afterwards
+    static bool make_directory(const std::string& path);
+    // Names of the directories in `path`, skipping hidden ones (none on Windows)
+    static std::vector<std::string> directories(const std::string& path);
+    static FileStamp stamp(const std::string& path);
+};
+
+#endif
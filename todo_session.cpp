@@ -0,0 +1,870 @@
+#include "todo_session.h"
+#include "todo_file.h"
+#include "binary_store.h"
+#include "stats.h"
+#include <algorithm>
+#include <cstdio>
+
+// Journal size past which a commit also rewrites the list files
+#define COMPACT_JOURNAL_BYTES (256 * 1024)
+
+// Reads of the lists that may be cut short by another process's commit
+#define READ_ATTEMPTS 5
+
+// Merges a commit retries outside the lock before it merges inside it, so
+// a busy writer cannot keep it out forever
+#define COMMIT_ATTEMPTS 4
+
+// How long the watcher lets a burst of file events settle before reading,
+// and how often it looks without being told where there is no inotify
+#define WATCH_SETTLE_MS 20
+#define WATCH_POLL_MS 1000
+
+// Ops the undo history holds on to; the oldest steps go first
+#define HISTORY_OPS 100000
+
+// Text lists share fixed companion names in their directory; a binary store
+// keeps its own, so both formats can live side by side
+static std::string journal_path(const bool binary, const std::string& primary) {
+    return binary ? primary + ".journal" : todofile::sibling(primary, "todo_journal.txt");
+}
+
+static std::string intent_path(const bool binary, const std::string& primary) {
+    return binary ? primary + ".pending" : todofile::sibling(primary, "todo_commit.pending");
+}
+
+static std::string lock_path(const bool binary, const std::string& primary) {
+    return binary ? primary + ".lock" : todofile::sibling(primary, "todo_commit.lock");
+}
+
+static std::string compact_lock_path(const bool binary, const std::string& primary) {
+    return binary ? primary + ".compact.lock" : todofile::sibling(primary, "todo_compact.lock");
+}
+
+// Writes the temps for one location and returns the paths to switch over
+static bool write_lists(const TodoStore& store, const bool binary, const std::string& primary,
+                        const std::string& regular, std::vector<std::string>& paths) {
+    std::string contents;
+    if (binary) {
+        binstore::format(store, contents);
+        paths.push_back(primary);
+        return todofile::write_temp(primary, contents);
+    }
+
+    todofile::format(store, true, contents);
+    if (!todofile::write_temp(primary, contents)) return false;
+    paths.push_back(primary);
+
+    contents.clear();
+    todofile::format(store, false, contents);
+    if (!todofile::write_temp(regular, contents)) return false;
+    paths.push_back(regular);
+    return true;
+}
+
+TodoSession::TodoSession(std::string pri_file, std::string reg_file)
+    : search_index(store), binary(false), priority_file(std::move(pri_file)), regular_file(std::move(reg_file)),
+      intent_file(intent_path(false, priority_file)), lock_file(lock_path(false, priority_file)),
+      compact_lock_file(compact_lock_path(false, priority_file)),
+      journal(journal_path(false, priority_file)), edits(0), loaded(), merged_commit(false), dropped_ops(0),
+      compacting(false), folded_from(), folded_to(), saving_now(false), save_result(SAVE_DONE), saved_state(),
+      mirror_state(), appended_from(), mirror_reloaded(false),
+      mirror_changed(false), merged_live(false), live_conflicts(0),
+      history_on(false), replaying(false), history_ops(0) {}
+
+TodoSession::TodoSession(std::string store_file)
+    : search_index(store), binary(true), priority_file(std::move(store_file)),
+      intent_file(intent_path(true, priority_file)), lock_file(lock_path(true, priority_file)),
+      compact_lock_file(compact_lock_path(true, priority_file)),
+      journal(journal_path(true, priority_file)), edits(0), loaded(), merged_commit(false), dropped_ops(0),
+      compacting(false), folded_from(), folded_to(), saving_now(false), save_result(SAVE_DONE), saved_state(),
+      mirror_state(), appended_from(), mirror_reloaded(false),
+      mirror_changed(false), merged_live(false), live_conflicts(0),
+      history_on(false), replaying(false), history_ops(0) {}
+
+TodoSession::~TodoSession() {
+    if (saver.joinable()) saver.join();
+    if (watcher) watcher->stop();
+    if (follower.joinable()) follower.join();
+    if (compactor.joinable()) compactor.join();
+}
+
+bool TodoSession::load() {
+    if (saver.joinable()) saver.join();
+    in_flight.clear();
+    search_index.reset();
+    pending.clear();
+    clear_history();
+    merged_live = false;
+    live_conflicts = 0;
+    edits++;
+    return read(store, loaded, false, load_error);
+}
+
+TodoSession::DiskState TodoSession::disk_state() const {
+    DiskState state;
+    state.primary = todofile::stamp(priority_file);
+    state.regular = todofile::stamp(regular_file);
+    state.journal = todofile::stamp(journal.path());
+    return state;
+}
+
+// Reads the lists and replays the journal into `into`, along with the state
+// of the files read. Another process may commit part way through; the read
+// then starts over, so the two always match, and the last attempt takes
+// the commit lock. `locked` says the commit lock is already held here.
+bool TodoSession::read(TodoStore& into, DiskState& state, const bool locked, std::string& error) {
+    STATS_TIMER(LOAD_US);
+    std::unique_ptr<FileLock> last_try;
+    bool held = locked;
+    for (int attempt = 1;; attempt++) {
+        // Finish a rewrite that was interrupted half way through. Under the
+        // lock, so one another process is still making is left alone.
+        if (todofile::exists(intent_file)) {
+            if (held) {
+                todofile::recover(intent_file);
+            } else {
+                FileLock guard(lock_file);
+                todofile::recover(intent_file);
+            }
+        }
+
+        into.clear();
+        error.clear();
+        state = disk_state();
+        if (binary) {
+            if (!binstore::load(priority_file, into, error) && !error.empty()) return false;
+        } else {
+            todofile::load(priority_file, into, true);
+            todofile::load(regular_file, into, false);
+        }
+        journal.replay(into);
+
+        if (held || disk_state() == state) return true;
+        // Commits keep landing under us: the last try holds them off
+        if (attempt + 1 >= READ_ATTEMPTS) {
+            last_try.reset(new FileLock(lock_file));
+            held = true;
+        }
+    }
+}
+
+void TodoSession::add_priority(const int priority, const std::string& desc) {
+    edits++;
+    search_index.add(store.add_priority(priority, desc));
+    pending.emplace_back(JournalOp::ADD_PRIORITY, priority, 0, desc);
+    record(pending.back());
+}
+
+void TodoSession::bump_from(const int starting_priority) {
+    edits++;
+    store.bump_from(starting_priority);
+    pending.emplace_back(JournalOp::BUMP, starting_priority, 0, std::string());
+    record(pending.back());
+}
+
+void TodoSession::unbump_from(const int starting_priority) {
+    edits++;
+    store.unbump_from(starting_priority);
+    pending.emplace_back(JournalOp::UNBUMP, starting_priority, 0, std::string());
+    record(pending.back());
+}
+
+void TodoSession::remove_priority(const TodoStore::ItemId id, const int priority) {
+    edits++;
+    pending.emplace_back(JournalOp::REMOVE_PRIORITY, priority, 0, store.description(id));
+    record(pending.back());
+    search_index.remove(id);
+    store.remove_priority(id, priority);
+}
+
+void TodoSession::reassign(const TodoStore::ItemId id, const int from, const int to) {
+    edits++;
+    pending.emplace_back(JournalOp::REASSIGN, from, to, store.description(id));
+    record(pending.back());
+    store.reassign(id, from, to);
+}
+
+void TodoSession::add_regular(const std::string& desc) {
+    edits++;
+    search_index.add(store.add_regular(desc));
+    pending.emplace_back(JournalOp::ADD_REGULAR, 0, 0, desc);
+    record(pending.back());
+}
+
+void TodoSession::insert_regular(const size_t index, const std::string& desc) {
+    edits++;
+    search_index.add(store.insert_regular(index, desc.data(), desc.size()));
+    pending.emplace_back(JournalOp::INSERT_REGULAR, 0, static_cast<int>(index), desc);
+    record(pending.back());
+}
+
+void TodoSession::remove_regular(const size_t index) {
+    edits++;
+    pending.emplace_back(JournalOp::REMOVE_REGULAR, 0, static_cast<int>(index),
+                         store.description(store.regular_items()[index]));
+    record(pending.back());
+    search_index.remove(store.regular_items()[index]);
+    store.remove_regular(index);
+}
+
+void TodoSession::import_priority(const std::vector<ImportItem>& items) {
+    if (items.empty()) return;
+    edits++;
+
+    size_t bytes = 0;
+    for (const ImportItem& item : items) bytes += item.length;
+    store.reserve(items.size(), bytes);
+
+    std::vector<std::pair<int, TodoStore::ItemId>> added;
+    added.reserve(items.size());
+    for (const ImportItem& item : items) {
+        added.emplace_back(item.priority, store.add_text(item.desc, item.length, TodoStore::LIVE | TodoStore::PRIORITY));
+    }
+
+    std::vector<bool> bumped;
+    store.merge_priorities(added, bumped);
+
+    pending.reserve(pending.size() + added.size() * 2);
+    const size_t first_op = pending.size();
+    for (size_t i = 0; i < added.size(); i++) {
+        if (bumped[i]) pending.emplace_back(JournalOp::BUMP, added[i].first, 0, std::string());
+        pending.emplace_back(JournalOp::ADD_PRIORITY, added[i].first, 0, store.description(added[i].second));
+        search_index.add(added[i].second);
+    }
+    for (size_t i = first_op; i < pending.size(); i++) record(pending[i]);
+}
+
+void TodoSession::import_regular(const std::vector<ImportItem>& items) {
+    if (items.empty()) return;
+    edits++;
+
+    size_t bytes = 0;
+    for (const ImportItem& item : items) bytes += item.length;
+    store.reserve(items.size(), bytes);
+    pending.reserve(pending.size() + items.size());
+
+    for (const ImportItem& item : items) {
+        const TodoStore::ItemId id = store.add_regular(item.desc, item.length);
+        pending.emplace_back(JournalOp::ADD_REGULAR, 0, 0, std::string(item.desc, item.length));
+        record(pending.back());
+        search_index.add(id);
+    }
+}
+
+bool TodoSession::compact_priorities() {
+    return renumber(JournalOp::COMPACT, JournalOp(JournalOp::COMPACT, 0, 0, std::string()));
+}
+
+bool TodoSession::move_priorities(const int first, const int last, const int before) {
+    return renumber(JournalOp::MOVE_RANGE, JournalOp(JournalOp::MOVE_RANGE, first, last, std::to_string(before)));
+}
+
+bool TodoSession::interleave_priorities(const int first, const int last, const int second_first, const int second_last) {
+    return renumber(JournalOp::INTERLEAVE, JournalOp(JournalOp::INTERLEAVE, first, last,
+                                                     std::to_string(second_first) + ' ' + std::to_string(second_last)));
+}
+
+// Makes the bulk renumbering `kind` with the numbers of `op`, which may be
+// of the kind it undoes, and records it
+bool TodoSession::renumber(const JournalOp::Kind kind, const JournalOp& op) {
+    std::string description = op.description;
+    int numbers[2];
+    bool changed = false;
+
+    switch (kind) {
+        case JournalOp::COMPACT:
+            description.clear();
+            Journal::encode_priorities(store, description);
+            changed = store.compact_priorities();
+            break;
+        case JournalOp::UNCOMPACT: {
+            std::vector<int> priorities;
+            changed = Journal::decode_priorities(description, store.priority_items().size(), priorities)
+                      && store.set_priorities(priorities);
+            break;
+        }
+        case JournalOp::MOVE_RANGE:
+        case JournalOp::UNMOVE_RANGE:
+            if (!Journal::decode_numbers(description, numbers, 1)) return false;
+            changed = kind == JournalOp::MOVE_RANGE ? store.move_priorities(op.priority, op.target, numbers[0])
+                                                    : store.unmove_priorities(op.priority, op.target, numbers[0]);
+            break;
+        case JournalOp::INTERLEAVE:
+        case JournalOp::UNINTERLEAVE:
+            if (!Journal::decode_numbers(description, numbers, 2)) return false;
+            changed = kind == JournalOp::INTERLEAVE
+                          ? store.interleave_priorities(op.priority, op.target, numbers[0], numbers[1])
+                          : store.uninterleave_priorities(op.priority, op.target, numbers[0], numbers[1]);
+            break;
+        default:
+            return false;
+    }
+    if (!changed) return false;
+
+    edits++;
+    pending.emplace_back(kind, op.priority, op.target, std::move(description));
+    record(pending.back());
+    return true;
+}
+
+size_t TodoSession::search(const std::string& query, std::vector<TodoStore::ItemId>& out, const size_t limit) {
+    if (!search_index.is_built()) search_index.build();
+    return search_index.find(query, out, limit);
+}
+
+bool TodoSession::commit() {
+    STATS_TIMER(COMMIT_US);
+    // Whatever a background save could not write is back in `pending`
+    if (saver.joinable()) saver.join();
+    finish_save();
+    merged_commit = false;
+    dropped_ops = 0;
+    if (pending.empty()) return true;
+
+    // The lock is held for a stat of each file and one append; merging with
+    // another process's commit happens outside it, except as a last resort
+    for (int attempt = 1;; attempt++) {
+        {
+            FileLock guard(lock_file);
+            if (!guard.is_locked()) return false;
+            if (!up_to_date() && attempt >= COMMIT_ATTEMPTS && !rebase(true)) return false;
+
+            if (up_to_date()) {
+                if (!journal.append(pending)) return false;
+                pending.clear();
+                loaded = disk_state();
+                break;
+            }
+        }
+        if (!rebase(false)) return false;
+    }
+
+    merged_live = false;
+    live_conflicts = 0;
+    if (loaded.journal.size >= COMPACT_JOURNAL_BYTES) start_compaction();
+    return true;
+}
+
+// Whether `current` is the files as this session last read or wrote them. A
+// fold made by our own compactor changes them without changing the lists.
+bool TodoSession::matches(const DiskState& current) {
+    if (current == loaded) return true;
+
+    std::lock_guard<std::mutex> guard(fold_lock);
+    if (folded_from != loaded || folded_to != current) return false;
+    loaded = current;
+    return true;
+}
+
+// Re-reads the lists as another process left them and replays the pending
+// edits onto them
+bool TodoSession::rebase(const bool locked) {
+    TodoStore theirs;
+    DiskState state;
+    std::string error;
+    if (!read(theirs, state, locked, error)) return false;
+
+    store = std::move(theirs);
+    loaded = state;
+    search_index.reset();
+    merged_commit = true;
+    edits++;
+
+    // What the history's steps were made against is gone
+    clear_history();
+    std::vector<JournalOp> ours;
+    ours.swap(pending);
+    replaying = true;
+    for (const JournalOp& op : ours) rebase_op(op);
+    replaying = false;
+    return true;
+}
+
+// Redoes one pending edit on lists that have changed underneath it. Items
+// are found by description once their priority or position has moved, and
+// edits to items that are gone are dropped. An item added or moved to a
+// priority that is now taken pushes the others down, as Bump does; our own
+// bumps are not replayed, since they were only ever made to free a slot.
+// Renumberings are made again over the same ranges, whatever is in them now;
+// an undone compaction only if the list still has as many items.
+void TodoSession::rebase_op(const JournalOp& op) {
+    switch (op.kind) {
+        case JournalOp::BUMP:
+        case JournalOp::UNBUMP:
+            break;
+        case JournalOp::ADD_PRIORITY:
+            if (store.has_priority(op.priority)) bump_from(op.priority);
+            add_priority(op.priority, op.description);
+            break;
+        case JournalOp::REMOVE_PRIORITY: {
+            const TodoStore::ItemId id = locate_priority(op.priority, op.description);
+            if (id == TodoStore::NO_ITEM) dropped_ops++;
+            else remove_priority(id, store.priority_of(id));
+            break;
+        }
+        case JournalOp::REASSIGN: {
+            const TodoStore::ItemId id = locate_priority(op.priority, op.description);
+            if (id == TodoStore::NO_ITEM) {
+                dropped_ops++;
+                break;
+            }
+            if (store.priority_of(id) == op.target) break;
+            if (store.has_priority(op.target)) bump_from(op.target);
+            reassign(id, store.priority_of(id), op.target);
+            break;
+        }
+        case JournalOp::ADD_REGULAR:
+            add_regular(op.description);
+            break;
+        case JournalOp::INSERT_REGULAR:
+            insert_regular(std::min(static_cast<size_t>(std::max(op.target, 0)), store.regular_items().size()),
+                           op.description);
+            break;
+        case JournalOp::REMOVE_REGULAR: {
+            const std::vector<TodoStore::ItemId>& regular = store.regular_items();
+            const char* desc = op.description.data();
+            const size_t length = op.description.size();
+            size_t index = static_cast<size_t>(op.target);
+            if (index >= regular.size() || !store.description_equals(regular[index], desc, length)) {
+                index = 0;
+                while (index < regular.size() && !store.description_equals(regular[index], desc, length)) index++;
+            }
+            if (index < regular.size()) remove_regular(index);
+            else dropped_ops++;
+            break;
+        }
+        case JournalOp::COMPACT:
+        case JournalOp::MOVE_RANGE:
+        case JournalOp::INTERLEAVE:
+        case JournalOp::UNMOVE_RANGE:
+        case JournalOp::UNINTERLEAVE:
+            renumber(op.kind, op);
+            break;
+        case JournalOp::UNCOMPACT:
+            if (!renumber(op.kind, op)) dropped_ops++;
+            break;
+    }
+}
+
+// The priority item with this description, preferably at `priority`
+TodoStore::ItemId TodoSession::locate_priority(const int priority, const std::string& desc) const {
+    const TodoStore::ItemId id = store.find_priority(priority, desc.data(), desc.size());
+    if (id != TodoStore::NO_ITEM) return id;
+    for (const auto& entry : store.priority_items()) {
+        if (store.description_equals(entry.second, desc.data(), desc.size())) return entry.second;
+    }
+    return TodoStore::NO_ITEM;
+}
+
+void TodoSession::record(const JournalOp& op) {
+    if (!history_on || replaying) return;
+    open_step.push_back(op);
+    redo_steps.clear();
+}
+
+void TodoSession::clear_history() {
+    undo_steps.clear();
+    redo_steps.clear();
+    open_step.clear();
+    history_ops = 0;
+}
+
+void TodoSession::keep_history(const bool keep) {
+    history_on = keep;
+    if (!keep) clear_history();
+}
+
+void TodoSession::end_step() {
+    if (open_step.empty()) return;
+    history_ops += open_step.size();
+    undo_steps.push_back(std::move(open_step));
+    open_step.clear();
+    while (history_ops > HISTORY_OPS && undo_steps.size() > 1) {
+        history_ops -= undo_steps.front().size();
+        undo_steps.pop_front();
+    }
+}
+
+bool TodoSession::undo() {
+    end_step();
+    if (undo_steps.empty()) return false;
+    std::vector<JournalOp> step = std::move(undo_steps.back());
+    undo_steps.pop_back();
+    history_ops -= step.size();
+
+    replaying = true;
+    bool undone = true;
+    for (auto op = step.rbegin(); op != step.rend() && undone; ++op) undone = revert_op(*op);
+    replaying = false;
+
+    if (!undone) {
+        clear_history();
+        return false;
+    }
+    redo_steps.push_back(std::move(step));
+    return true;
+}
+
+bool TodoSession::redo() {
+    end_step();
+    if (redo_steps.empty()) return false;
+    std::vector<JournalOp> step = std::move(redo_steps.back());
+    redo_steps.pop_back();
+
+    replaying = true;
+    bool redone = true;
+    for (auto op = step.begin(); op != step.end() && redone; ++op) redone = redo_op(*op);
+    replaying = false;
+
+    if (!redone) {
+        clear_history();
+        return false;
+    }
+    history_ops += step.size();
+    undo_steps.push_back(std::move(step));
+    return true;
+}
+
+// Makes the edit that cancels `op`, the latest edit not yet undone. Steps
+// are undone newest first, so every item is where `op` left it.
+bool TodoSession::revert_op(const JournalOp& op) {
+    const char* desc = op.description.data();
+    const size_t length = op.description.size();
+    const std::vector<TodoStore::ItemId>& regular = store.regular_items();
+
+    switch (op.kind) {
+        case JournalOp::BUMP:
+            if (store.has_priority(op.priority)) return false;
+            unbump_from(op.priority);
+            return true;
+        case JournalOp::UNBUMP:
+            bump_from(op.priority);
+            return true;
+        case JournalOp::ADD_PRIORITY: {
+            const TodoStore::ItemId id = store.find_priority(op.priority, desc, length);
+            if (id == TodoStore::NO_ITEM) return false;
+            remove_priority(id, op.priority);
+            return true;
+        }
+        case JournalOp::REMOVE_PRIORITY:
+            add_priority(op.priority, op.description);
+            return true;
+        case JournalOp::REASSIGN: {
+            const TodoStore::ItemId id = store.find_priority(op.target, desc, length);
+            if (id == TodoStore::NO_ITEM) return false;
+            reassign(id, op.target, op.priority);
+            return true;
+        }
+        case JournalOp::ADD_REGULAR:
+        case JournalOp::INSERT_REGULAR: {
+            const size_t index = op.kind == JournalOp::ADD_REGULAR ? regular.size() - 1 : static_cast<size_t>(op.target);
+            if (regular.empty() || index >= regular.size() || !store.description_equals(regular[index], desc, length)) {
+                return false;
+            }
+            remove_regular(index);
+            return true;
+        }
+        case JournalOp::REMOVE_REGULAR:
+            if (static_cast<size_t>(op.target) > regular.size()) return false;
+            insert_regular(static_cast<size_t>(op.target), op.description);
+            return true;
+        case JournalOp::COMPACT:
+            return renumber(JournalOp::UNCOMPACT, op);
+        case JournalOp::UNCOMPACT:
+            return renumber(JournalOp::COMPACT, op);
+        case JournalOp::MOVE_RANGE:
+            return renumber(JournalOp::UNMOVE_RANGE, op);
+        case JournalOp::UNMOVE_RANGE:
+            return renumber(JournalOp::MOVE_RANGE, op);
+        case JournalOp::INTERLEAVE:
+            return renumber(JournalOp::UNINTERLEAVE, op);
+        case JournalOp::UNINTERLEAVE:
+            return renumber(JournalOp::INTERLEAVE, op);
+    }
+    return false;
+}
+
+// Makes `op` again, right after the step before it was redone
+bool TodoSession::redo_op(const JournalOp& op) {
+    const char* desc = op.description.data();
+    const size_t length = op.description.size();
+    const std::vector<TodoStore::ItemId>& regular = store.regular_items();
+
+    switch (op.kind) {
+        case JournalOp::BUMP:
+            bump_from(op.priority);
+            return true;
+        case JournalOp::UNBUMP:
+            if (store.has_priority(op.priority)) return false;
+            unbump_from(op.priority);
+            return true;
+        case JournalOp::ADD_PRIORITY:
+            add_priority(op.priority, op.description);
+            return true;
+        case JournalOp::REMOVE_PRIORITY:
+        case JournalOp::REASSIGN: {
+            const TodoStore::ItemId id = store.find_priority(op.priority, desc, length);
+            if (id == TodoStore::NO_ITEM) return false;
+            if (op.kind == JournalOp::REASSIGN) reassign(id, op.priority, op.target);
+            else remove_priority(id, op.priority);
+            return true;
+        }
+        case JournalOp::ADD_REGULAR:
+            add_regular(op.description);
+            return true;
+        case JournalOp::INSERT_REGULAR:
+            if (static_cast<size_t>(op.target) > regular.size()) return false;
+            insert_regular(static_cast<size_t>(op.target), op.description);
+            return true;
+        case JournalOp::REMOVE_REGULAR: {
+            const size_t index = static_cast<size_t>(op.target);
+            if (index >= regular.size() || !store.description_equals(regular[index], desc, length)) return false;
+            remove_regular(index);
+            return true;
+        }
+        case JournalOp::COMPACT:
+        case JournalOp::UNCOMPACT:
+        case JournalOp::MOVE_RANGE:
+        case JournalOp::UNMOVE_RANGE:
+        case JournalOp::INTERLEAVE:
+        case JournalOp::UNINTERLEAVE:
+            return renumber(op.kind, op);
+    }
+    return false;
+}
+
+void TodoSession::watch(std::function<void()> changed) {
+    if (watcher) return;
+    on_change = std::move(changed);
+    watcher.reset(new FileWatcher({priority_file, regular_file, journal.path()}));
+    follower = std::thread(&TodoSession::follow, this);
+}
+
+// The watcher thread. Keeps `mirror` equal to the files: an append to the
+// journal is decoded from where the last one ended and applied, anything
+// else (a fold, a replaced list file) means reading the lists again.
+void TodoSession::follow() {
+    {
+        TodoStore fresh;
+        DiskState state;
+        std::string error;
+        if (read(fresh, state, false, error)) {
+            std::lock_guard<std::mutex> guard(mirror_lock);
+            mirror = std::move(fresh);
+            mirror_state = state;
+            mirror_reloaded = true;
+            mirror_changed = true;
+        }
+        if (on_change) on_change();
+    }
+
+    while (!watcher->stopped()) {
+        if (!watcher->wait(WATCH_POLL_MS)) continue;
+        // A commit or a fold touches several files; let it finish
+        while (watcher->wait(WATCH_SETTLE_MS)) {}
+        if (watcher->stopped()) break;
+
+        const DiskState now = disk_state();
+        const DiskState from = mirror_state;  // only this thread writes it
+        if (now == from) continue;
+
+        const bool appended_only = now.primary == from.primary && now.regular == from.regular
+                                   && now.journal.exists && from.journal.exists
+                                   && now.journal.device == from.journal.device
+                                   && now.journal.inode == from.journal.inode
+                                   && now.journal.size > from.journal.size;
+        if (appended_only) {
+            std::vector<JournalOp> ops;
+            const size_t end = journal.read_from(static_cast<size_t>(from.journal.size), ops);
+            if (end == from.journal.size) continue;
+
+            // Stop where the complete lines did; the rest comes with its event
+            DiskState state = now;
+            state.journal.size = end;
+
+            std::lock_guard<std::mutex> guard(mirror_lock);
+            if (appended.empty() && !mirror_reloaded) appended_from = from;
+            for (const JournalOp& op : ops) Journal::apply(op, mirror);
+            appended.insert(appended.end(), ops.begin(), ops.end());
+            mirror_state = state;
+        } else {
+            TodoStore fresh;
+            DiskState state;
+            std::string error;
+            if (!read(fresh, state, false, error)) continue;
+
+            std::lock_guard<std::mutex> guard(mirror_lock);
+            mirror = std::move(fresh);
+            mirror_state = state;
+            mirror_reloaded = true;
+            appended.clear();
+        }
+        mirror_changed = true;
+        if (on_change) on_change();
+    }
+}
+
+bool TodoSession::sync() {
+    // The pending edits are split while a save is under way; it calls back
+    // when done, and the lists catch up then
+    if (saving_now) return false;
+    finish_save();
+    if (!mirror_changed.exchange(false)) return false;
+
+    std::lock_guard<std::mutex> guard(mirror_lock);
+    const bool incremental = !mirror_reloaded && appended_from == loaded;
+    std::vector<JournalOp> ops;
+    ops.swap(appended);
+    mirror_reloaded = false;
+
+    // Our own commit or fold, come back round
+    if (matches(mirror_state)) return false;
+
+    clear_history();
+    if (incremental && pending.empty()) {
+        for (const JournalOp& op : ops) Journal::apply(op, store);
+    } else {
+        // Copying the mirror is a few memcpys; what was read or parsed to
+        // build it was done on the watcher thread
+        store = mirror;
+        std::vector<JournalOp> ours;
+        ours.swap(pending);
+        const size_t dropped_before = dropped_ops;
+        replaying = true;
+        for (const JournalOp& op : ours) rebase_op(op);
+        replaying = false;
+        live_conflicts += dropped_ops - dropped_before;
+        dropped_ops = dropped_before;
+        if (!ours.empty()) merged_live = true;
+    }
+
+    loaded = mirror_state;
+    search_index.reset();
+    edits++;
+    return true;
+}
+
+bool TodoSession::save() {
+    if (saving_now) return true;
+    if (!finish_save()) return false;
+    if (pending.empty()) return true;
+    if (!up_to_date()) return commit();
+
+    // Only the op list changes hands; the saver never touches the store
+    in_flight.swap(pending);
+    saving_now = true;
+    saver = std::thread(&TodoSession::write_in_flight, this, loaded);
+    return true;
+}
+
+// The saver thread. Appends `in_flight` if the files are still as they were
+// at `from`, as commit() would under the lock, and leaves the rest to
+// finish_save() on the session's own thread.
+void TodoSession::write_in_flight(const DiskState from) {
+    STATS_TIMER(COMMIT_US);
+    SaveResult result = SAVE_FAILED;
+    {
+        FileLock guard(lock_file);
+        if (guard.is_locked()) {
+            const DiskState current = disk_state();
+            bool unchanged = current == from;
+            if (!unchanged) {
+                std::lock_guard<std::mutex> fold_guard(fold_lock);
+                unchanged = folded_from == from && folded_to == current;
+            }
+
+            if (!unchanged) {
+                result = SAVE_STALE;
+            } else if (journal.append(in_flight)) {
+                saved_state = disk_state();
+                result = SAVE_DONE;
+            }
+        }
+    }
+    save_result = result;
+    saving_now = false;
+    if (on_change) on_change();
+}
+
+// Takes in the outcome of a finished background save. Saved ops are done
+// with; otherwise they go back in front of the edits made since, for the
+// next save or commit to merge. Returns false if the save failed.
+bool TodoSession::finish_save() {
+    if (saving_now || in_flight.empty()) return true;
+    if (saver.joinable()) saver.join();
+
+    if (save_result == SAVE_DONE) {
+        in_flight.clear();
+        loaded = saved_state;
+        if (pending.empty()) {
+            merged_live = false;
+            live_conflicts = 0;
+            // The snapshot must match `loaded`, so not while edits are pending
+            if (loaded.journal.size >= COMPACT_JOURNAL_BYTES) start_compaction();
+        }
+        return true;
+    }
+
+    in_flight.insert(in_flight.end(), pending.begin(), pending.end());
+    pending.swap(in_flight);
+    in_flight.clear();
+    return save_result == SAVE_STALE;
+}
+
+void TodoSession::start_compaction() {
+    if (compacting) return;
+    if (compactor.joinable()) compactor.join();
+
+    // The store is a handful of flat arrays, so the snapshot is a few
+    // memcpys; the slow part (writing the files) happens off this thread.
+    // Nothing is pending right after a commit, so it matches `loaded`.
+    compacting = true;
+    compactor = std::thread(&TodoSession::compact, this, store, loaded);
+}
+
+void TodoSession::compact(TodoStore snapshot, const DiskState state) {
+    STATS_TIMER(FOLD_US);
+    // One compaction at a time across processes, since they share the temp
+    // names; a process that finds one running leaves it to finish
+    FileLock running(compact_lock_file, false);
+    std::vector<std::string> paths;
+    if (running.is_locked() && write_lists(snapshot, binary, priority_file, regular_file, paths)) {
+        // The lists and the shortened journal switch over together. Ops
+        // appended since the snapshot are kept, but if the lists or the
+        // journal were rewritten meanwhile the snapshot is stale.
+        FileLock guard(lock_file);
+        const DiskState before = disk_state();
+        const bool current = before.primary == state.primary && before.regular == state.regular
+                             && before.journal.exists && before.journal.device == state.journal.device
+                             && before.journal.inode == state.journal.inode
+                             && before.journal.size >= state.journal.size;
+
+        if (current && journal.fold(static_cast<size_t>(state.journal.size), intent_file, paths)) {
+            std::lock_guard<std::mutex> fold_guard(fold_lock);
+            folded_from = before;
+            folded_to = disk_state();
+        } else {
+            for (const std::string& path : paths) std::remove((path + ".tmp").c_str());
+        }
+    }
+    compacting = false;
+}
+
+bool TodoSession::export_text(const std::string& pri_file, const std::string& reg_file) const {
+    std::vector<std::string> paths;
+    const std::string target_journal = journal_path(false, pri_file);
+    if (!write_lists(store, false, pri_file, reg_file, paths)) return false;
+    if (!todofile::write_temp(target_journal, std::string())) return false;
+    paths.push_back(target_journal);
+    return todofile::switch_over(intent_path(false, pri_file), paths);
+}
+
+bool TodoSession::export_binary(const std::string& store_file) const {
+    std::vector<std::string> paths;
+    const std::string target_journal = journal_path(true, store_file);
+    if (!write_lists(store, true, store_file, std::string(), paths)) return false;
+    if (!todofile::write_temp(target_journal, std::string())) return false;
+    paths.push_back(target_journal);
+    return todofile::switch_over(intent_path(true, store_file), paths);
+}
@@ -0,0 +1,228 @@
+#ifndef TODO_SESSION_H
+#define TODO_SESSION_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "todo_store.h"
+#include "todo_file.h"
+#include "journal.h"
+#include "search_index.h"
+#include "file_watcher.h"
+
+// The lists of one location loaded into a TodoStore: either a pair of text
+// files or a single binary store, plus the journal next to them. Every edit
+// goes through here so it can be recorded; commit() appends just those
+// records to the journal, and the journal is folded back into the list
+// files on a background thread once it grows past a threshold.
+//
+// Several processes may share a location. Commits take an advisory lock
+// only long enough to check the files are as they were at load and append;
+// if another process got there first, the lists are re-read outside the
+// lock and the pending edits replayed onto them before trying again. With
+// watch(), the same happens as soon as another process commits.
+//
+// save() is commit() for autosave: the append and its flush to disk happen
+// on a background thread, so the caller never waits on the disk.
+class TodoSession {
+public:
+    // Text lists
+    TodoSession(std::string pri_file, std::string reg_file);
+    // Binary store (see binary_store.h)
+    explicit TodoSession(std::string store_file);
+    ~TodoSession();
+
+    TodoSession(const TodoSession&) = delete;
+    TodoSession& operator=(const TodoSession&) = delete;
+
+    // Reads the lists and replays the journal on top of them. Returns false
+    // if a binary store exists but cannot be read; see error().
+    bool load();
+    const std::string& error() const { return load_error; }
+
+    const TodoStore& lists() const { return store; }
+    bool is_binary() const { return binary; }
+    const std::string& priority_path() const { return priority_file; }
+    const std::string& regular_path() const { return regular_file; }
+    bool has_changes() const { return !pending.empty() || !in_flight.empty(); }
+    // Goes up with every edit and reload, so views know when to rebuild
+    unsigned long revision() const { return edits; }
+
+    void add_priority(int priority, const std::string& desc);
+    // Adds 1 to every priority >= starting_priority
+    void bump_from(int starting_priority);
+    void remove_priority(TodoStore::ItemId id, int priority);
+    void reassign(TodoStore::ItemId id, int from, int to);
+    void add_regular(const std::string& desc);
+    void remove_regular(size_t index);
+
+    // Bulk adds; the descriptions are copied in, not kept. Priority items
+    // land where adding them one at a time in ascending priority order,
+    // with a bump on each conflict, would put them (see
+    // TodoStore::merge_priorities), and are recorded as those same ops.
+    struct ImportItem {
+        int priority;
+        const char* desc;
+        size_t length;
+    };
+    void import_priority(const std::vector<ImportItem>& items);
+    void import_regular(const std::vector<ImportItem>& items);
+
+    // Bulk renumbering (see TodoStore::compact_priorities and the two after
+    // it). Each is one op however many items it moves, and one undo step's
+    // worth of work. False, recording nothing, if nothing would change.
+    bool compact_priorities();
+    bool move_priorities(int first, int last, int before);
+    bool interleave_priorities(int first, int last, int second_first, int second_last);
+
+    // Items in either list whose description contains `query` (see
+    // SearchIndex::find). The index is built on the first search and kept
+    // up to date by the edits above from then on.
+    size_t search(const std::string& query, std::vector<TodoStore::ItemId>& out, size_t limit);
+
+    // Undo history, off unless asked for. The edits made between two calls
+    // to end_step() are one step, undone and redone together. Steps hold
+    // the ops already recorded for the journal, so a bump costs one number
+    // rather than a copy of the list, and undoing or redoing a step costs
+    // what making it did. An undo is itself an edit, committed like any
+    // other. History is dropped when changes made elsewhere come in.
+    void keep_history(bool keep);
+    void end_step();
+    bool can_undo() const { return !undo_steps.empty() || !open_step.empty(); }
+    bool can_redo() const { return !redo_steps.empty(); }
+    // False if there is nothing to undo (redo), or the step no longer fits
+    // the lists; the history is dropped then
+    bool undo();
+    bool redo();
+
+    // Makes pending edits durable; returns false if the journal write failed
+    bool commit();
+    // Whether the last commit had to merge with edits committed elsewhere,
+    // and how many of ours were dropped because their item was gone
+    bool merged() const { return merged_commit; }
+    size_t dropped() const { return dropped_ops; }
+
+    // Starts appending the pending edits to the journal on the saver thread
+    // and returns at once. They are swapped out of the pending list, not
+    // copied, and edits made meanwhile queue up behind them. If the files
+    // changed since they were read, commits here instead, merging as
+    // commit() does. Returns false if that or the last background save
+    // failed; a save still under way is left to finish.
+    bool save();
+    // Whether a background save is under way
+    bool saving() const { return saving_now; }
+
+    // Follows what other processes commit from a background thread, which
+    // keeps its own copy of the lists as they are on disk. sync() takes
+    // the changes in on the caller's thread; `changed` is called from the
+    // watcher thread whenever there is something for it to take.
+    void watch(std::function<void()> changed = nullptr);
+    // Brings the lists up to date with what the watcher has seen, replaying
+    // pending edits on top; never waits on the disk. Returns true if the
+    // lists changed.
+    bool sync();
+    // Whether pending edits were merged onto changes made elsewhere since
+    // the last commit, and how many were dropped because their item was gone
+    bool diverged() const { return merged_live; }
+    size_t conflicts() const { return live_conflicts; }
+
+    // Write the current lists, pending edits included, to another location,
+    // replacing whatever lists and journal were there
+    bool export_text(const std::string& pri_file, const std::string& reg_file) const;
+    bool export_binary(const std::string& store_file) const;
+
+private:
+    // The files on disk as of the last load or commit
+    struct DiskState {
+        FileStamp primary;
+        FileStamp regular;
+        FileStamp journal;
+
+        bool operator==(const DiskState& other) const {
+            return primary == other.primary && regular == other.regular && journal == other.journal;
+        }
+        bool operator!=(const DiskState& other) const { return !(*this == other); }
+    };
+
+    TodoStore store;
+    SearchIndex search_index;
+    bool binary;
+    std::string priority_file;  // the store file in binary mode
+    std::string regular_file;
+    std::string intent_file;
+    std::string lock_file;
+    std::string compact_lock_file;
+    Journal journal;
+    std::vector<JournalOp> pending;
+    std::string load_error;
+    unsigned long edits;
+    DiskState loaded;
+    bool merged_commit;
+    size_t dropped_ops;
+
+    std::thread compactor;
+    std::atomic<bool> compacting;
+    std::mutex fold_lock;    // guards the two states below
+    DiskState folded_from;   // the last fold made here turned this state...
+    DiskState folded_to;     // ...into this one, without changing the lists
+
+    // Autosave (see save()). The saver thread owns the three below until
+    // it clears `saving_now`.
+    enum SaveResult { SAVE_DONE, SAVE_STALE, SAVE_FAILED };
+    std::thread saver;
+    std::atomic<bool> saving_now;
+    std::vector<JournalOp> in_flight;  // taken out of `pending` for the saver
+    SaveResult save_result;
+    DiskState saved_state;
+
+    // Following other processes (see watch())
+    std::unique_ptr<FileWatcher> watcher;
+    std::thread follower;
+    std::function<void()> on_change;
+    std::mutex mirror_lock;          // guards the five below
+    TodoStore mirror;                // the lists as on disk
+    DiskState mirror_state;
+    std::vector<JournalOp> appended; // ops applied to the mirror since the last sync()...
+    DiskState appended_from;         // ...starting from this state
+    bool mirror_reloaded;            // the mirror was read afresh since the last sync()
+    std::atomic<bool> mirror_changed;
+    bool merged_live;
+    size_t live_conflicts;
+
+    // Undo history (see keep_history())
+    bool history_on;
+    bool replaying;  // edits made by undo, redo or a merge are not steps
+    std::deque<std::vector<JournalOp>> undo_steps;
+    std::vector<std::vector<JournalOp>> redo_steps;
+    std::vector<JournalOp> open_step;
+    size_t history_ops;  // in undo_steps, for HISTORY_OPS
+
+    DiskState disk_state() const;
+    bool read(TodoStore& into, DiskState& state, bool locked, std::string& error);
+    bool matches(const DiskState& state);
+    bool up_to_date() { return matches(disk_state()); }
+    void follow();
+    bool rebase(bool locked);
+    void rebase_op(const JournalOp& op);
+    TodoStore::ItemId locate_priority(int priority, const std::string& desc) const;
+
+    void record(const JournalOp& op);
+    void clear_history();
+    void unbump_from(int starting_priority);
+    void insert_regular(size_t index, const std::string& desc);
+    bool renumber(JournalOp::Kind kind, const JournalOp& op);
+    bool revert_op(const JournalOp& op);
+    bool redo_op(const JournalOp& op);
+
+    void start_compaction();
+    void compact(TodoStore snapshot, DiskState state);
+    void write_in_flight(DiskState from);
+    bool finish_save();
+};
+
+#endif
@@ -0,0 +1,311 @@
+#include "todo_store.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+// Garbage below this size is never worth a compaction pass
+#define MIN_COMPACT_BYTES (64 * 1024)
+
+const TodoStore::ItemId TodoStore::NO_ITEM;
+
+TodoStore::ItemId TodoStore::find_priority(const int priority) const {
+    const ItemId* id = priority_list.find(priority);
+    return id ? *id : NO_ITEM;
+}
+
+TodoStore::ItemId TodoStore::add_priority(const int priority, const char* desc, const size_t length) {
+    const ItemId id = add_text(desc, length, LIVE | PRIORITY);
+    set_handle(id, priority_list.insert(priority, id));
+    return id;
+}
+
+TodoStore::ItemId TodoStore::find_priority(const int priority, const char* desc, const size_t length) const {
+    for (auto it = priority_list.lower_bound(priority); it != priority_list.end(); ++it) {
+        if ((*it).first != priority) break;
+        if (description_equals((*it).second, desc, length)) return (*it).second;
+    }
+    return NO_ITEM;
+}
+
+bool TodoStore::remove_priority(const ItemId id, const int priority) {
+    if (!priority_list.erase(priority, id)) return false;
+    release(id);
+    return true;
+}
+
+void TodoStore::reassign(const ItemId id, const int from, const int to) {
+    if (priority_list.erase(from, id)) set_handle(id, priority_list.insert(to, id));
+}
+
+// Number of items with a priority <= `priority`
+size_t TodoStore::rank_after(const int priority) const {
+    return priority == INT_MAX ? priority_list.size() : priority_list.rank(priority + 1);
+}
+
+bool TodoStore::compact_priorities() {
+    std::vector<std::pair<int, ItemId>> entries;
+    entries.reserve(priority_list.size());
+    bool changed = false;
+    for (const auto& entry : priority_list) {
+        const int next = static_cast<int>(entries.size()) + 1;
+        changed = changed || entry.first != next;
+        entries.emplace_back(next, entry.second);
+    }
+    if (changed) assign_priorities(entries);
+    return changed;
+}
+
+bool TodoStore::set_priorities(const std::vector<int>& values) {
+    if (values.size() != priority_list.size() || !std::is_sorted(values.begin(), values.end())) return false;
+    std::vector<std::pair<int, ItemId>> entries;
+    entries.reserve(values.size());
+    size_t i = 0;
+    for (const auto& entry : priority_list) entries.emplace_back(values[i++], entry.second);
+    assign_priorities(entries);
+    return true;
+}
+
+bool TodoStore::move_priorities(const int first, const int last, const int before) {
+    return move(first, last, before, false);
+}
+
+bool TodoStore::unmove_priorities(const int first, const int last, const int before) {
+    return move(first, last, before, true);
+}
+
+// A move keeps every priority where it was, so the ranks of the range and
+// of `before` are the same after it, and `undo` rotates the span back
+bool TodoStore::move(const int first, const int last, const int before, const bool undo) {
+    const size_t from = priority_list.rank(first);
+    const size_t to = rank_after(last);
+    const size_t at = priority_list.rank(before);
+    if (first > last || from >= to || (at >= from && at <= to)) return false;
+
+    std::vector<std::pair<int, ItemId>> entries;
+    entries.reserve(priority_list.size());
+    for (const auto& entry : priority_list) entries.emplace_back(entry.first, entry.second);
+
+    // Rotate the items of the span the range crosses, then give the span its
+    // priorities back in their old order
+    const size_t begin = std::min(from, at);
+    const size_t end = std::max(to, at);
+    std::vector<int> values;
+    values.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) values.push_back(entries[i].first);
+    const size_t moved = to - from;
+    size_t middle = at < from ? from : to;
+    if (undo) middle = at < from ? begin + moved : end - moved;
+    std::rotate(entries.begin() + static_cast<std::ptrdiff_t>(begin),
+                entries.begin() + static_cast<std::ptrdiff_t>(middle),
+                entries.begin() + static_cast<std::ptrdiff_t>(end));
+    for (size_t i = begin; i < end; i++) entries[i].first = values[i - begin];
+    assign_priorities(entries);
+    return true;
+}
+
+bool TodoStore::interleave_priorities(const int first, const int last, const int second_first, const int second_last) {
+    return interleave(first, last, second_first, second_last, false);
+}
+
+bool TodoStore::uninterleave_priorities(const int first, const int last, const int second_first, const int second_last) {
+    return interleave(first, last, second_first, second_last, true);
+}
+
+// Interleaving keeps the priorities of the span from the first range to the
+// second, so with the same ranges the counts that went into it can still be
+// read off the list, and `undo` can deal the items back out
+bool TodoStore::interleave(const int first, const int last, const int second_first, const int second_last,
+                           const bool undo) {
+    if (first > last || last >= second_first || second_first > second_last) return false;
+    const size_t begin = priority_list.rank(first);
+    const size_t first_end = rank_after(last);
+    const size_t second_begin = priority_list.rank(second_first);
+    const size_t end = rank_after(second_last);
+    const size_t from_first = first_end - begin;
+    const size_t from_second = end - second_begin;
+    const size_t between = second_begin - first_end;
+    if (from_first == 0 || from_second == 0) return false;
+
+    std::vector<std::pair<int, ItemId>> entries;
+    entries.reserve(priority_list.size());
+    for (const auto& entry : priority_list) entries.emplace_back(entry.first, entry.second);
+
+    // Offsets into the span: `apart` with the ranges apart, `dealt` with
+    // them interleaved
+    std::vector<ItemId> span;
+    span.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) span.push_back(entries[i].second);
+    size_t taken_first = 0, taken_second = 0;
+    for (size_t dealt = 0; dealt < from_first + from_second; dealt++) {
+        const bool take_first = taken_first < from_first && (taken_second >= from_second || taken_first <= taken_second);
+        const size_t apart = take_first ? taken_first++ : from_first + between + taken_second++;
+        if (undo) entries[begin + apart].second = span[dealt];
+        else entries[begin + dealt].second = span[apart];
+    }
+    for (size_t i = 0; i < between; i++) {
+        if (undo) entries[begin + from_first + i].second = span[from_first + from_second + i];
+        else entries[begin + from_first + from_second + i].second = span[from_first + i];
+    }
+    assign_priorities(entries);
+    return true;
+}
+
+void TodoStore::assign_priorities(std::vector<std::pair<int, ItemId>>& entries) {
+    priority_list.assign(entries);
+    handles.resize(items.size());
+    for (size_t i = 0; i < entries.size(); i++) handles[entries[i].second] = static_cast<PriorityIndex<ItemId>::Handle>(i);
+}
+
+void TodoStore::merge_priorities(std::vector<std::pair<int, ItemId>>& added, std::vector<bool>& bumped) {
+    std::stable_sort(added.begin(), added.end(),
+                     [](const std::pair<int, ItemId>& a, const std::pair<int, ItemId>& b) { return a.first < b.first; });
+    bumped.assign(added.size(), false);
+
+    // Once an added item at q is placed, nothing below q moves again, so
+    // the list is emitted front to back. Every bump shifts all of what is
+    // left by one, tracked as `shift`; added items not yet emitted sit on a
+    // stack (lowest on top) ahead of the remaining existing items.
+    std::vector<std::pair<int, ItemId>> merged;
+    merged.reserve(priority_list.size() + added.size());
+    std::vector<std::pair<int, ItemId>> placed;
+    auto it = priority_list.begin();
+    const auto end = priority_list.end();
+    int shift = 0;
+
+    for (size_t i = 0; i < added.size(); i++) {
+        const int priority = added[i].first;
+        while (!placed.empty() && placed.back().first + shift < priority) {
+            merged.emplace_back(placed.back().first + shift, placed.back().second);
+            placed.pop_back();
+        }
+        if (placed.empty()) {
+            for (; it != end && (*it).first + shift < priority; ++it) merged.emplace_back((*it).first + shift, (*it).second);
+        }
+
+        const bool taken = placed.empty() ? it != end && (*it).first + shift == priority
+                                          : placed.back().first + shift == priority;
+        if (taken) {
+            shift++;
+            bumped[i] = true;
+        }
+        placed.emplace_back(priority - shift, added[i].second);
+    }
+
+    while (!placed.empty()) {
+        merged.emplace_back(placed.back().first + shift, placed.back().second);
+        placed.pop_back();
+    }
+    for (; it != end; ++it) merged.emplace_back((*it).first + shift, (*it).second);
+
+    assign_priorities(merged);
+}
+
+void TodoStore::set_handle(const ItemId id, const PriorityIndex<ItemId>::Handle handle) {
+    if (id >= handles.size()) handles.resize(items.size());
+    handles[id] = handle;
+}
+
+TodoStore::ItemId TodoStore::add_regular(const char* desc, const size_t length) {
+    const ItemId id = add_text(desc, length, LIVE);
+    regular_list.push_back(id);
+    return id;
+}
+
+TodoStore::ItemId TodoStore::insert_regular(const size_t index, const char* desc, const size_t length) {
+    const ItemId id = add_text(desc, length, LIVE);
+    regular_list.insert(regular_list.begin() + static_cast<std::ptrdiff_t>(std::min(index, regular_list.size())), id);
+    return id;
+}
+
+void TodoStore::remove_regular(const size_t index) {
+    release(regular_list[index]);
+    regular_list.erase(regular_list.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+bool TodoStore::description_equals(const ItemId id, const char* desc, const size_t length) const {
+    return items[id].length == length && std::memcmp(description_data(id), desc, length) == 0;
+}
+
+void TodoStore::reserve(const size_t item_count, const size_t text_bytes) {
+    items.reserve(items.size() + item_count);
+    text.reserve(text.size() + text_bytes);
+}
+
+TodoStore::ItemId TodoStore::allocate_header() {
+    if (free_items != NO_ITEM) {
+        const ItemId id = free_items;
+        free_items = items[id].offset;
+        return id;
+    }
+    items.push_back(ItemHeader());
+    return static_cast<ItemId>(items.size() - 1);
+}
+
+TodoStore::ItemId TodoStore::add_text(const char* desc, const size_t length, const uint32_t flags) {
+    const ItemId id = allocate_header();
+    ItemHeader& header = items[id];
+    header.offset = static_cast<uint32_t>(text.size());
+    header.length = static_cast<uint32_t>(length);
+    header.flags = flags;
+    text.insert(text.end(), desc, desc + length);
+    return id;
+}
+
+void TodoStore::attach_base(std::shared_ptr<const void> owner, const char* data) {
+    base = std::move(owner);
+    base_data = data;
+}
+
+TodoStore::ItemId TodoStore::add_external(const uint32_t offset, const uint32_t length, const uint32_t flags) {
+    const ItemId id = allocate_header();
+    ItemHeader& header = items[id];
+    header.offset = offset;
+    header.length = length;
+    header.flags = flags | EXTERNAL;
+    return id;
+}
+
+void TodoStore::clear() {
+    priority_list.clear();
+    regular_list.clear();
+    handles.clear();
+    items.clear();
+    text.clear();
+    base.reset();
+    base_data = nullptr;
+    dead_bytes = 0;
+    free_items = NO_ITEM;
+}
+
+void TodoStore::release(const ItemId id) {
+    ItemHeader& header = items[id];
+    if (!(header.flags & EXTERNAL)) dead_bytes += header.length;
+    header.flags = 0;
+    header.length = 0;
+    header.offset = free_items;
+    free_items = id;
+
+    if (dead_bytes >= MIN_COMPACT_BYTES && dead_bytes * 2 > text.size()) compact_text();
+}
+
+// Slides every live description down over the dead bytes. Recycled headers
+// point anywhere in the arena, so live items are visited in offset order.
+void TodoStore::compact_text() {
+    std::vector<ItemId> order;
+    order.reserve(items.size());
+    for (ItemId id = 0; id < items.size(); id++) {
+        if ((items[id].flags & LIVE) && !(items[id].flags & EXTERNAL)) order.push_back(id);
+    }
+    std::sort(order.begin(), order.end(),
+        [this](const ItemId a, const ItemId b) { return items[a].offset < items[b].offset; });
+
+    size_t write = 0;
+    for (const ItemId id : order) {
+        ItemHeader& header = items[id];
+        if (header.offset != write) std::memmove(text.data() + write, text.data() + header.offset, header.length);
+        header.offset = static_cast<uint32_t>(write);
+        write += header.length;
+    }
+    text.resize(write);
+    dead_bytes = 0;
+}
@@ -0,0 +1,153 @@
+#ifndef TODO_STORE_H
+#define TODO_STORE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "priority_index.h"
+
+// Fixed-size record for one item. The description bytes live in the store's
+// text arena (or, with EXTERNAL set, in a read-only base such as a mapped
+// binary store); only their position is kept here.
+struct ItemHeader {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t flags;
+};
+
+// Both TODO lists in compact form: one contiguous header array, one byte
+// arena for every description, and the priority order kept as item ids in a
+// PriorityIndex. Removing an item only marks its bytes dead; the arena is
+// compacted once enough of it is garbage.
+class TodoStore {
+public:
+    typedef uint32_t ItemId;
+    static const ItemId NO_ITEM = 0xFFFFFFFFu;
+
+    enum Flags : uint32_t {
+        LIVE = 1u << 0,
+        PRIORITY = 1u << 1,
+        EXTERNAL = 1u << 2  // bytes are in the attached base, not the arena
+    };
+
+    TodoStore() : base_data(nullptr), dead_bytes(0), free_items(NO_ITEM) {}
+
+    // Priority items in ascending priority order, as (priority, id)
+    const PriorityIndex<ItemId>& priority_items() const { return priority_list; }
+    // Regular items in insertion order
+    const std::vector<ItemId>& regular_items() const { return regular_list; }
+
+    const char* description_data(const ItemId id) const {
+        return (items[id].flags & EXTERNAL ? base_data : text.data()) + items[id].offset;
+    }
+    size_t description_size(const ItemId id) const { return items[id].length; }
+    std::string description(const ItemId id) const {
+        return std::string(description_data(id), description_size(id));
+    }
+    bool description_equals(ItemId id, const char* desc, size_t length) const;
+
+    bool is_priority(const ItemId id) const { return (items[id].flags & PRIORITY) != 0; }
+
+    // First item holding `priority`, or NO_ITEM
+    ItemId find_priority(int priority) const;
+    // Item holding `priority` with exactly this description, or NO_ITEM.
+    // Tells duplicate priorities apart when replaying a journal.
+    ItemId find_priority(int priority, const char* desc, size_t length) const;
+    bool has_priority(const int priority) const { return priority_list.contains(priority); }
+    // Current priority of a priority item, in O(log n)
+    int priority_of(const ItemId id) const { return priority_list.priority_of(handles[id]); }
+
+    ItemId add_priority(int priority, const char* desc, size_t length);
+    ItemId add_priority(const int priority, const std::string& desc) {
+        return add_priority(priority, desc.data(), desc.size());
+    }
+    // Adds 1 to every priority >= starting_priority
+    void bump_from(const int starting_priority) { priority_list.bump_from(starting_priority); }
+    // Undoes bump_from(starting_priority), which must be free again:
+    // takes 1 off every priority > starting_priority
+    void unbump_from(const int starting_priority) { priority_list.shift_from(starting_priority + 1, -1); }
+    bool remove_priority(ItemId id, int priority);
+    // Moves item `id` from priority `from` to `to`
+    void reassign(ItemId id, int from, int to);
+
+    // Bulk renumbering. Each is one pass over the priority list and a
+    // linear rebuild of the index, however many items it moves.
+    //
+    // Gives the items priorities 1..N in their current order; false if
+    // they have them already
+    bool compact_priorities();
+    // Gives the items `values` in their current order; false, changing
+    // nothing, unless there is one per item and they are ascending
+    bool set_priorities(const std::vector<int>& values);
+    // Moves the items with priorities in [first, last] to just before the
+    // first item at or above `before` (to the end if there is none). The
+    // priorities themselves stay where they are; the items between the old
+    // and new place take the ones the range leaves. False, changing nothing,
+    // if no item would move.
+    bool move_priorities(int first, int last, int before);
+    // Undoes move_priorities with the same arguments
+    bool unmove_priorities(int first, int last, int before);
+    // Deals the items in [first, last] and [second_first, second_last], which
+    // must come after, out alternately starting with the first range, into
+    // the place of the first range; the items between the ranges follow
+    // them. Priorities stay where they are, as in move_priorities. False,
+    // changing nothing, if the ranges overlap or either has no items.
+    bool interleave_priorities(int first, int last, int second_first, int second_last);
+    // Undoes interleave_priorities with the same ranges
+    bool uninterleave_priorities(int first, int last, int second_first, int second_last);
+
+    ItemId add_regular(const char* desc, size_t length);
+    ItemId add_regular(const std::string& desc) { return add_regular(desc.data(), desc.size()); }
+    // Adds a regular item at position `index` rather than at the end
+    ItemId insert_regular(size_t index, const char* desc, size_t length);
+    void remove_regular(size_t index);
+
+    // Bulk loading: reserve arena space, append descriptions, then hand the
+    // priority order over in one go
+    void reserve(size_t item_count, size_t text_bytes);
+    ItemId add_text(const char* desc, size_t length, uint32_t flags);
+
+    // Lets items point into `data` instead of copying it into the arena.
+    // `owner` keeps the bytes alive for as long as any copy of the store.
+    void attach_base(std::shared_ptr<const void> owner, const char* data);
+    ItemId add_external(uint32_t offset, uint32_t length, uint32_t flags);
+    void assign_priorities(std::vector<std::pair<int, ItemId>>& entries);
+    // Places `added` (ids from add_text) as if each had been added in
+    // ascending priority order, bumping everything at and below it whenever
+    // its priority was taken -- but in one O(n + k) pass over the list.
+    // On return `added` is in that order, and bumped[i] tells whether
+    // added[i] needed the bump.
+    void merge_priorities(std::vector<std::pair<int, ItemId>>& added, std::vector<bool>& bumped);
+    void append_regular(const ItemId id) { regular_list.push_back(id); }
+    void clear();
+
+    // Memory accounting for the benchmarks
+    size_t header_bytes() const {
+        return items.capacity() * sizeof(ItemHeader) + handles.capacity() * sizeof(PriorityIndex<ItemId>::Handle);
+    }
+    size_t text_bytes() const { return text.capacity(); }
+    size_t garbage_bytes() const { return dead_bytes; }
+
+private:
+    PriorityIndex<ItemId> priority_list;
+    std::vector<ItemId> regular_list;
+    std::vector<PriorityIndex<ItemId>::Handle> handles;  // by item id, for priority items
+    std::vector<ItemHeader> items;
+    std::vector<char> text;
+    std::shared_ptr<const void> base;
+    const char* base_data;
+    size_t dead_bytes;
+    ItemId free_items;  // released headers, chained through `offset`
+
+    ItemId allocate_header();
+    void set_handle(ItemId id, PriorityIndex<ItemId>::Handle handle);
+    size_t rank_after(int priority) const;
+    bool move(int first, int last, int before, bool undo);
+    bool interleave(int first, int last, int second_first, int second_last, bool undo);
+    void release(ItemId id);
+    void compact_text();
+};
+
+#endif
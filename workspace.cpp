@@ -0,0 +1,220 @@
+#include "workspace.h"
+#include "todo_file.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <utility>
+
+// Longest list name, in bytes (all of them ASCII)
+#define MAX_NAME 40
+
+Workspace::Workspace(std::string priority_file, std::string regular_file, const size_t budget)
+    : priority_file(std::move(priority_file)), regular_file(std::move(regular_file)),
+      lists_dir(todofile::sibling(this->priority_file, "todo_lists")),
+      manifest_file(todofile::sibling(this->priority_file, "todo_lists.txt")),
+      lock_file(todofile::sibling(this->priority_file, "todo_lists.lock")),
+      intent_file(todofile::sibling(this->priority_file, "todo_lists.intent")),
+      budget(budget > 0 ? budget : 1) {
+    refresh();
+}
+
+Workspace::~Workspace() {
+    std::vector<Entry> counts;
+    for (const OpenList& list : open_lists) counts.push_back(count(list.name, *list.session));
+    if (!counts.empty()) write_counts(counts);
+}
+
+bool Workspace::valid_name(const std::string& name) {
+    if (name.empty() || name.size() > MAX_NAME || name[0] == ' ' || name[0] == '.') return false;
+    for (const char c : name) {
+        const bool allowed = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                             || c == ' ' || c == '-' || c == '_' || c == '.';
+        if (!allowed) return false;
+    }
+    return true;
+}
+
+std::string Workspace::label(const std::string& name) {
+    return name.empty() ? "(default)" : name;
+}
+
+std::string Workspace::directory_of(const std::string& name) const {
+    return lists_dir + "/" + name;
+}
+
+Workspace::Entry Workspace::count(const std::string& name, const TodoSession& session) {
+    return {name, true, session.lists().priority_items().size(), session.lists().regular_items().size()};
+}
+
+// One line per list: <priority items>|<regular items>|<name>
+void Workspace::read_manifest(std::vector<Entry>& into) const {
+    std::ifstream file(manifest_file);
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t first = line.find('|');
+        const size_t second = first == std::string::npos ? first : line.find('|', first + 1);
+        if (second == std::string::npos) continue;
+
+        Entry entry{line.substr(second + 1), true, 0, 0};
+        if (!entry.name.empty() && !valid_name(entry.name)) continue;
+        entry.priority_items = std::strtoul(line.c_str(), nullptr, 10);
+        entry.regular_items = std::strtoul(line.c_str() + first + 1, nullptr, 10);
+        into.push_back(entry);
+    }
+}
+
+// Folds `counts` into `current`; false if that changes nothing
+static bool merge_counts(std::vector<Workspace::Entry>& current, const std::vector<Workspace::Entry>& counts) {
+    bool changed = false;
+    for (const Workspace::Entry& update : counts) {
+        auto it = std::find_if(current.begin(), current.end(),
+                               [&](const Workspace::Entry& e) { return e.name == update.name; });
+        if (it == current.end()) {
+            current.push_back(update);
+            changed = true;
+        } else if (it->priority_items != update.priority_items || it->regular_items != update.regular_items) {
+            *it = update;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Merges `counts` into the manifest on disk, under its lock, so processes
+// sharing the location only ever add to what the others wrote. Neither the
+// manifest nor its lock is made while there are no named lists, or when
+// the counts on disk already match
+bool Workspace::write_counts(const std::vector<Entry>& counts) {
+    if (!todofile::exists(manifest_file) && !todofile::is_directory(lists_dir)) return true;
+    std::vector<Entry> current;
+    read_manifest(current);
+    if (!merge_counts(current, counts)) return true;
+
+    FileLock guard(lock_file);
+    todofile::recover(intent_file);
+
+    current.clear();
+    read_manifest(current);
+    if (!merge_counts(current, counts)) return true;
+
+    std::string contents;
+    for (const Entry& entry : current) {
+        contents += std::to_string(entry.priority_items) + "|" + std::to_string(entry.regular_items) + "|";
+        contents += entry.name + "\n";
+    }
+    return todofile::write_temp(manifest_file, contents) && todofile::switch_over(intent_file, {manifest_file});
+}
+
+void Workspace::refresh() {
+    std::vector<Entry> found;
+    read_manifest(found);
+
+    entries.clear();
+    entries.push_back({"", false, 0, 0});
+    for (const Entry& entry : found) {
+        if (entry.name.empty()) entries.front() = entry;
+        else if (todofile::is_directory(directory_of(entry.name))) entries.push_back(entry);
+    }
+
+    // Made by hand, or by a process that could not write the manifest
+    for (const std::string& name : todofile::directories(lists_dir)) {
+        if (!valid_name(name)) continue;
+        const bool known = std::any_of(entries.begin(), entries.end(),
+                                       [&](const Entry& e) { return e.name == name; });
+        if (!known) entries.push_back({name, false, 0, 0});
+    }
+
+    for (const OpenList& list : open_lists) {
+        for (Entry& entry : entries) {
+            if (entry.name == list.name) entry = count(list.name, *list.session);
+        }
+    }
+
+    std::sort(entries.begin() + 1, entries.end(),
+              [](const Entry& a, const Entry& b) { return a.name < b.name; });
+}
+
+bool Workspace::exists(const std::string& name) const {
+    return name.empty() || (valid_name(name) && todofile::is_directory(directory_of(name)));
+}
+
+bool Workspace::create(const std::string& name) {
+    if (!valid_name(name)) {
+        last_error = "names are letters, digits, spaces, '-', '_' and '.'";
+        return false;
+    }
+    if (exists(name)) {
+        last_error = "there already is a list called " + name;
+        return false;
+    }
+    if (!todofile::make_directory(lists_dir) || !todofile::make_directory(directory_of(name))) {
+        last_error = "could not make " + directory_of(name);
+        return false;
+    }
+
+    const Entry entry{name, true, 0, 0};
+    write_counts({entry});
+    entries.push_back(entry);
+    std::sort(entries.begin() + 1, entries.end(),
+              [](const Entry& a, const Entry& b) { return a.name < b.name; });
+    return true;
+}
+
+std::unique_ptr<TodoSession> Workspace::session(const std::string& name) const {
+    const std::string pri_file = name.empty() ? priority_file : directory_of(name) + "/priority_todo.txt";
+    const std::string reg_file = name.empty() ? regular_file : directory_of(name) + "/regular_todo.txt";
+    const std::string store_file = todofile::sibling(pri_file, "todo.tdb");
+    if (todofile::exists(store_file)) return std::unique_ptr<TodoSession>(new TodoSession(store_file));
+    return std::unique_ptr<TodoSession>(new TodoSession(pri_file, reg_file));
+}
+
+TodoSession* Workspace::open(const std::string& name) {
+    for (auto it = open_lists.begin(); it != open_lists.end(); ++it) {
+        if (it->name != name) continue;
+        open_lists.splice(open_lists.begin(), open_lists, it);
+        return open_lists.front().session.get();
+    }
+
+    if (!exists(name)) {
+        last_error = "there is no list called " + name;
+        return nullptr;
+    }
+    std::unique_ptr<TodoSession> loaded = session(name);
+    if (!loaded->load()) {
+        last_error = loaded->priority_path() + ": " + loaded->error();
+        return nullptr;
+    }
+
+    open_lists.push_front(OpenList{name, std::move(loaded)});
+    evict(name);
+    return open_lists.front().session.get();
+}
+
+// Closes the least recently opened lists past the budget, but never `keep`
+// or one whose edits would be lost
+void Workspace::evict(const std::string& keep) {
+    std::vector<Entry> counts;
+    for (auto it = open_lists.end(); open_lists.size() > budget && it != open_lists.begin();) {
+        --it;
+        if (it->name == keep || it->session->has_changes() || it->session->saving()) continue;
+        counts.push_back(count(it->name, *it->session));
+        it = open_lists.erase(it);
+    }
+    if (!counts.empty()) write_counts(counts);
+}
+
+size_t Workspace::unsaved() const {
+    size_t count = 0;
+    for (const OpenList& list : open_lists) {
+        if (list.session->has_changes()) count++;
+    }
+    return count;
+}
+
+void Workspace::note(const std::string& name, const TodoSession& session) {
+    const Entry entry = count(name, session);
+    write_counts({entry});
+    for (Entry& known : entries) {
+        if (known.name == name) known = entry;
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include "todo_session.h"
+
+// Lists kept open at once, unless they have edits not yet written
+#define OPEN_LISTS 4
+
+// The named lists of one location. The lists the location always had are
+// the default list, named ""; every other list lives in todo_lists/<name>/
+// next to them, with files of its own (text or binary, journal and all).
+//
+// Lists are loaded the first time they are opened and stay open after, so
+// going back to one keeps its undo history and uncommitted edits. Once more
+// than `budget` are open, the least recently opened are closed again; a
+// list with edits not yet written is kept open regardless.
+//
+// A manifest (todo_lists.txt) caches the item count of every list, so the
+// overview shows them all without reading any. Counts are written as lists
+// are closed or left, and are only as fresh as that.
+class Workspace {
+public:
+    struct Entry {
+        std::string name;
+        bool counted;  // false until the list has been opened somewhere
+        size_t priority_items;
+        size_t regular_items;
+    };
+
+    Workspace(std::string priority_file, std::string regular_file, size_t budget = OPEN_LISTS);
+    // Writes the counts of the lists still open
+    ~Workspace();
+
+    Workspace(const Workspace&) = delete;
+    Workspace& operator=(const Workspace&) = delete;
+
+    // Letters, digits, space, '-', '_' and '.', up to 40 of them, not
+    // starting with a space or '.'
+    static bool valid_name(const std::string& name);
+    // "(default)" for the default list
+    static std::string label(const std::string& name);
+
+    // Re-reads the manifest and looks for lists other processes added.
+    // Open lists show their live counts.
+    void refresh();
+    // Default list first, then by name
+    const std::vector<Entry>& lists() const { return entries; }
+    bool exists(const std::string& name) const;
+
+    // Makes an empty list; false if the name is not valid or is taken, or
+    // its directory could not be made (see error())
+    bool create(const std::string& name);
+
+    // The list called `name`, loaded if it is not open yet. Null if there
+    // is no such list or it cannot be read (see error()).
+    TodoSession* open(const std::string& name);
+    // A session on the list's files that is not loaded or kept, for one-off
+    // work like the headless commands; a binary store takes precedence
+    std::unique_ptr<TodoSession> session(const std::string& name) const;
+    // Open lists with edits not yet written
+    size_t unsaved() const;
+    // Records the counts of `session`, a loaded session on list `name`
+    void note(const std::string& name, const TodoSession& session);
+
+    const std::string& error() const { return last_error; }
+
+private:
+    struct OpenList {
+        std::string name;
+        std::unique_ptr<TodoSession> session;
+    };
+
+    std::string priority_file;
+    std::string regular_file;
+    std::string lists_dir;
+    std::string manifest_file;
+    std::string lock_file;
+    std::string intent_file;
+    size_t budget;
+
+    std::vector<Entry> entries;
+    std::list<OpenList> open_lists;  // most recently opened first
+    std::string last_error;
+
+    std::string directory_of(const std::string& name) const;
+    void read_manifest(std::vector<Entry>& into) const;
+    bool write_counts(const std::vector<Entry>& counts);
+    void evict(const std::string& keep);
+    static Entry count(const std::string& name, const TodoSession& session);
+};
+
+#endif